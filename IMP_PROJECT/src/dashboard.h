@@ -0,0 +1,105 @@
+/*
+ * @file dashboard.h
+ * @brief Gzip compressed web page, generated from web/index.html by tools/embed_dashboard.py. Do not edit.
+ */
+
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include <stdint.h>
+
+#define DASHBOARD_ETAG "\"64fef9c880080397\"" // etag of page, changes with content
+#define DASHBOARD_SIZE 1371 // size of compressed page, uncompressed 4244
+
+static const uint8_t dashboard_html_gz[DASHBOARD_SIZE] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xb5, 0x58, 0x6d, 0x6f, 0xdb, 0x36,
+    0x10, 0xfe, 0x9e, 0x5f, 0x71, 0xfd, 0x32, 0xca, 0x88, 0x25, 0x3b, 0x29, 0x06, 0x0c, 0x89, 0xed,
+    0x21, 0xcd, 0x3a, 0xac, 0x43, 0xd7, 0x06, 0x88, 0xbb, 0x61, 0x18, 0x86, 0x82, 0x91, 0xce, 0x11,
+    0x5b, 0x5a, 0x14, 0x48, 0xca, 0x6e, 0x50, 0xf8, 0x3f, 0xed, 0x37, 0xec, 0x97, 0xed, 0x68, 0xca,
+    0xd6, 0x8b, 0x69, 0xef, 0x5d, 0x40, 0x12, 0xcb, 0x7c, 0xee, 0x78, 0xf7, 0xdc, 0xf1, 0xee, 0x98,
+    0xc9, 0xb3, 0x6f, 0xde, 0xde, 0xce, 0x7f, 0xbe, 0x7b, 0x09, 0xdf, 0xcd, 0x7f, 0x78, 0x3d, 0x3b,
+    0x9b, 0xe4, 0x76, 0x29, 0xdd, 0x1f, 0xe4, 0xd9, 0xec, 0x0c, 0xe8, 0x99, 0x58, 0x61, 0x25, 0xce,
+    0x5e, 0xde, 0xdf, 0x3d, 0xbf, 0x84, 0x18, 0xe6, 0xb8, 0x2c, 0x51, 0x73, 0x5b, 0x69, 0x04, 0xab,
+    0x94, 0x9c, 0x8c, 0xfc, 0xba, 0xc7, 0x2e, 0xd1, 0x72, 0x28, 0xf8, 0x12, 0xa7, 0x6c, 0x25, 0x70,
+    0x5d, 0x2a, 0x6d, 0x19, 0xa4, 0xaa, 0xb0, 0x58, 0xd8, 0x29, 0x5b, 0x8b, 0xcc, 0xe6, 0xd3, 0x0c,
+    0x57, 0x22, 0xc5, 0x78, 0xfb, 0x32, 0x04, 0x51, 0x08, 0x2b, 0xb8, 0x8c, 0x4d, 0xca, 0x25, 0x4e,
+    0x2f, 0x92, 0x31, 0xe1, 0x73, 0xae, 0x0d, 0x12, 0xfe, 0xdd, 0xfc, 0xdb, 0xf8, 0x2b, 0x56, 0xab,
+    0x36, 0xf6, 0x89, 0xb6, 0x81, 0xfc, 0x72, 0x08, 0x25, 0x7c, 0x86, 0x05, 0x29, 0x8d, 0x17, 0x7c,
+    0x29, 0xe4, 0xd3, 0x15, 0xdc, 0x68, 0x52, 0x31, 0x04, 0xc3, 0x0b, 0x13, 0x1b, 0xd4, 0x62, 0x71,
+    0x0d, 0x9b, 0xc9, 0xc8, 0x4b, 0xd4, 0xd2, 0xa9, 0x16, 0xa5, 0xf5, 0x2f, 0xee, 0x59, 0x54, 0x45,
+    0x6a, 0x85, 0x2a, 0xa0, 0x2a, 0x33, 0x6e, 0xb1, 0xe5, 0x55, 0x34, 0x80, 0xcf, 0x7b, 0xd8, 0x16,
+    0x8a, 0x36, 0xcd, 0x23, 0x36, 0x7a, 0x44, 0xfb, 0xde, 0x36, 0x38, 0x36, 0x48, 0x6c, 0x8e, 0x45,
+    0xa4, 0xd1, 0x94, 0xaa, 0x30, 0x08, 0xd3, 0x19, 0xec, 0x3e, 0x27, 0x16, 0x3f, 0xd9, 0x68, 0x50,
+    0x23, 0x0a, 0x5c, 0xb7, 0x59, 0x23, 0x5c, 0x77, 0x03, 0xf7, 0x64, 0x2a, 0xad, 0x96, 0x44, 0x52,
+    0x42, 0xbb, 0xbc, 0x94, 0xe8, 0x3e, 0xbe, 0x78, 0x7a, 0x95, 0x45, 0xac, 0xbb, 0xa3, 0x28, 0x0a,
+    0xd4, 0x73, 0x52, 0x0e, 0x53, 0xe8, 0xa9, 0x3d, 0x07, 0x06, 0xbf, 0xff, 0x76, 0xcb, 0xae, 0x3b,
+    0xba, 0x37, 0x83, 0xe6, 0x7d, 0x73, 0x76, 0xe8, 0x3e, 0xf1, 0x3c, 0xcf, 0xc9, 0xec, 0x5c, 0xc9,
+    0xec, 0xc0, 0xf3, 0x15, 0xd7, 0x60, 0x77, 0xab, 0x3f, 0x72, 0x59, 0x91, 0xf1, 0x27, 0x2c, 0xdd,
+    0x21, 0xc9, 0xce, 0x95, 0x03, 0x5f, 0x07, 0x69, 0x34, 0x8e, 0xc6, 0x3d, 0x74, 0x18, 0xe0, 0x82,
+    0x92, 0x28, 0x57, 0xd9, 0x15, 0xb0, 0xbb, 0xb7, 0xf7, 0x73, 0x36, 0x3c, 0x58, 0x77, 0xb9, 0x89,
+    0xda, 0x5c, 0xc1, 0x67, 0x76, 0xeb, 0x53, 0x2b, 0x9e, 0x3f, 0x95, 0xc8, 0x48, 0x82, 0x97, 0xa5,
+    0x14, 0x29, 0x77, 0xae, 0x8d, 0x3e, 0xc5, 0xeb, 0xf5, 0x3a, 0x5e, 0x28, 0xbd, 0x8c, 0x2b, 0x2d,
+    0xb1, 0x48, 0x55, 0x86, 0xb4, 0xe1, 0xe6, 0x50, 0xe1, 0x83, 0xca, 0x28, 0x89, 0x1a, 0x07, 0xa6,
+    0x8c, 0xd8, 0xec, 0x3a, 0x3e, 0x3c, 0xca, 0xea, 0x8e, 0x28, 0x51, 0x94, 0xd5, 0x8e, 0x90, 0xbf,
+    0x44, 0xd3, 0xfb, 0x87, 0xca, 0x5a, 0x55, 0xb0, 0x80, 0xae, 0x92, 0x6b, 0xfe, 0xa8, 0x79, 0x99,
+    0xb7, 0x15, 0xa5, 0x1a, 0x29, 0x53, 0x6b, 0x5d, 0x11, 0x2b, 0xfb, 0x82, 0x7b, 0xa1, 0x6d, 0xf6,
+    0xd5, 0xcc, 0x90, 0x02, 0xb6, 0x0f, 0xb0, 0x8b, 0x36, 0x98, 0x2a, 0x4d, 0xd1, 0x98, 0x45, 0x25,
+    0xe5, 0x53, 0xd2, 0xcb, 0x96, 0xb6, 0x0f, 0x94, 0x6b, 0x74, 0x94, 0xec, 0x4d, 0xf6, 0x81, 0xa7,
+    0xf4, 0xba, 0xdf, 0x97, 0x2f, 0x2c, 0x6a, 0x2c, 0x5c, 0xe8, 0xf6, 0x3b, 0xf6, 0x2c, 0x71, 0x49,
+    0x25, 0x96, 0xa8, 0x2a, 0x1b, 0xed, 0x12, 0xcd, 0xe5, 0x56, 0xcb, 0x42, 0xfa, 0x44, 0xca, 0xde,
+    0x50, 0x44, 0x12, 0x8d, 0x4b, 0xb5, 0xc2, 0xdb, 0x5c, 0x50, 0x02, 0xb6, 0x14, 0xc2, 0x66, 0x08,
+    0xcf, 0xc7, 0xe3, 0xf1, 0x9f, 0xe4, 0x2f, 0xb1, 0xfb, 0x9a, 0x1b, 0x7b, 0x31, 0x6e, 0x1d, 0x05,
+    0x73, 0xf2, 0x08, 0x4b, 0x82, 0xbf, 0xbf, 0x18, 0xb7, 0x8f, 0xb2, 0x39, 0x79, 0x96, 0x3f, 0x18,
+    0x67, 0x7e, 0x8d, 0xa0, 0x62, 0xc1, 0xc3, 0x27, 0x98, 0xaa, 0x9c, 0xb1, 0xd0, 0xd2, 0xea, 0x22,
+    0xc0, 0x05, 0x9d, 0xd7, 0x93, 0xd9, 0xd0, 0xe0, 0xe3, 0x74, 0x27, 0xd0, 0x8f, 0xac, 0x7b, 0x42,
+    0x8a, 0x7d, 0x39, 0x70, 0x85, 0xdb, 0x85, 0x99, 0x1d, 0x0a, 0x51, 0xf2, 0x43, 0x24, 0x29, 0xe8,
+    0x82, 0x00, 0xe3, 0x6b, 0xfa, 0x33, 0x01, 0xe7, 0x41, 0xd2, 0xd2, 0x96, 0xd0, 0xd1, 0x78, 0xb4,
+    0x39, 0x2d, 0x9e, 0x9f, 0x0f, 0x02, 0x7e, 0x35, 0xbe, 0x51, 0xc1, 0xb9, 0xfb, 0x27, 0x89, 0xb9,
+    0x7b, 0xda, 0xf2, 0x9d, 0x4a, 0xd6, 0x37, 0xe9, 0x17, 0xf1, 0x6b, 0x58, 0x43, 0x90, 0x04, 0x3a,
+    0xf3, 0x94, 0x8e, 0x3e, 0x81, 0xda, 0x5b, 0x04, 0xac, 0xd8, 0xfc, 0xad, 0xda, 0xc8, 0xb3, 0xac,
+    0xdd, 0x17, 0x34, 0xa6, 0x4a, 0x67, 0x7d, 0x8a, 0xfe, 0xc7, 0xb0, 0xff, 0x3b, 0xd6, 0x8f, 0xb2,
+    0xed, 0xfd, 0xe8, 0x82, 0x8f, 0x64, 0x97, 0x2b, 0x00, 0x2f, 0x90, 0xb2, 0x08, 0x3b, 0xcc, 0x0e,
+    0xc3, 0xf8, 0x85, 0xd0, 0xc6, 0x6e, 0xe3, 0xd0, 0x33, 0x65, 0x4d, 0xdf, 0x21, 0x44, 0x41, 0xa1,
+    0xd4, 0xe1, 0xa9, 0x18, 0xd4, 0x69, 0x08, 0x33, 0xb8, 0x18, 0x87, 0xd2, 0x30, 0x28, 0xdc, 0xae,
+    0x1d, 0x41, 0x80, 0x3b, 0xec, 0x21, 0x8b, 0x36, 0xa7, 0x9b, 0x62, 0xae, 0xd6, 0x37, 0x92, 0x7c,
+    0x8f, 0xb8, 0xfb, 0x1d, 0x0e, 0xf9, 0xaa, 0xee, 0x87, 0x5b, 0x48, 0x52, 0xbf, 0x4d, 0xa9, 0x2d,
+    0x53, 0x61, 0x85, 0xaf, 0x81, 0xc5, 0x31, 0x83, 0xab, 0xf6, 0x6a, 0x62, 0xd5, 0xb7, 0xe2, 0x13,
+    0x66, 0xd1, 0x65, 0xcf, 0x98, 0xa3, 0x59, 0xb2, 0x15, 0xee, 0x75, 0x7d, 0xb6, 0x35, 0x0c, 0x5c,
+    0x87, 0xf2, 0xba, 0x75, 0x25, 0x7d, 0xf3, 0x8f, 0x9a, 0xef, 0x2c, 0xb5, 0x43, 0xf7, 0xdd, 0x00,
+    0xd4, 0xc2, 0x8d, 0x53, 0x24, 0x2f, 0x9d, 0xc8, 0x01, 0xab, 0x1e, 0xbe, 0x43, 0x9c, 0x83, 0x77,
+    0x38, 0xe1, 0xc4, 0xc3, 0x0a, 0x9d, 0x17, 0xa0, 0xb9, 0x30, 0xe8, 0x9a, 0x31, 0xb8, 0x1f, 0x8d,
+    0x12, 0xb9, 0x7f, 0x1f, 0x10, 0xbc, 0xd7, 0xe6, 0x5b, 0x5c, 0x8e, 0x46, 0x50, 0x2a, 0x29, 0x45,
+    0xf1, 0x08, 0xc2, 0x40, 0x45, 0x22, 0xa0, 0x0a, 0xf9, 0x44, 0xa9, 0x80, 0x05, 0x48, 0xa7, 0xdc,
+    0x0f, 0x5e, 0x06, 0xa8, 0x13, 0x40, 0xa1, 0x2c, 0xf0, 0x15, 0x17, 0x92, 0x3f, 0x48, 0x3c, 0xeb,
+    0x74, 0x42, 0xaf, 0xe4, 0xde, 0x72, 0x6d, 0x49, 0xc7, 0x14, 0x16, 0x5c, 0x9a, 0xd6, 0x96, 0x4d,
+    0xcc, 0x1c, 0xe2, 0xce, 0xa3, 0x0f, 0xea, 0xbf, 0x58, 0x40, 0xf4, 0xac, 0xab, 0x2a, 0x94, 0x63,
+    0x07, 0x9b, 0x59, 0xdd, 0x9f, 0x62, 0xea, 0xf6, 0xf6, 0x8a, 0x9a, 0xab, 0x26, 0xef, 0xa3, 0x83,
+    0xf1, 0x71, 0x08, 0x97, 0xdd, 0xae, 0x15, 0x92, 0x0a, 0x76, 0xad, 0xa0, 0xe4, 0xe9, 0x44, 0xa5,
+    0x4c, 0x2c, 0x30, 0xb5, 0xaf, 0x89, 0xcf, 0x77, 0x9e, 0xce, 0xb0, 0xeb, 0x11, 0xfb, 0x09, 0x1f,
+    0xee, 0x55, 0xfa, 0x11, 0x69, 0x1c, 0x17, 0x05, 0xac, 0x45, 0x91, 0xa9, 0xf5, 0x20, 0xc4, 0x41,
+    0x97, 0xc7, 0x43, 0x37, 0x34, 0x92, 0xb1, 0xc5, 0x31, 0x23, 0x9b, 0xe3, 0x61, 0xb6, 0xbb, 0xf9,
+    0x31, 0x15, 0xf6, 0xbb, 0x47, 0x6c, 0x6d, 0xae, 0x46, 0x23, 0x97, 0xa9, 0x52, 0xf9, 0x39, 0x2d,
+    0xc9, 0x15, 0xc1, 0x29, 0x59, 0x47, 0x6b, 0xd3, 0xaf, 0x61, 0x5e, 0x49, 0xa2, 0x8a, 0x25, 0x4d,
+    0x2c, 0xfc, 0xd1, 0x1d, 0x37, 0x5c, 0x6d, 0xa7, 0x9a, 0xe3, 0x1d, 0xb8, 0x81, 0x7e, 0x7f, 0xff,
+    0xf6, 0x8d, 0x9b, 0x34, 0x0c, 0x46, 0x5b, 0xa9, 0xc4, 0xf5, 0x99, 0x80, 0x4b, 0x8e, 0xa2, 0x5a,
+    0x2a, 0x09, 0x1e, 0xf8, 0xbd, 0x39, 0xfb, 0xba, 0xd0, 0x85, 0x87, 0x9b, 0x55, 0x88, 0xa9, 0x43,
+    0xb6, 0x5a, 0x8c, 0xf1, 0x65, 0x29, 0x9d, 0xdd, 0xb5, 0xf2, 0xeb, 0xff, 0xe2, 0x92, 0xe0, 0x95,
+    0x26, 0xab, 0x56, 0xf1, 0x39, 0x72, 0x53, 0xd8, 0x96, 0x83, 0x6e, 0xc7, 0xab, 0x85, 0x5d, 0x74,
+    0x02, 0x7a, 0xfa, 0x99, 0x7a, 0x24, 0x74, 0xa9, 0x54, 0x6e, 0xa0, 0x02, 0xca, 0xcc, 0x60, 0xd4,
+    0x4e, 0x25, 0xdc, 0x26, 0x58, 0x5b, 0x8e, 0xcc, 0x7c, 0x0d, 0x36, 0x70, 0xa7, 0x6b, 0x16, 0x43,
+    0x67, 0xc6, 0xaf, 0xd2, 0x8d, 0xb1, 0xbe, 0x25, 0x4e, 0x46, 0xfe, 0xfe, 0x3b, 0x71, 0x37, 0x83,
+    0xfa, 0x06, 0x99, 0x5f, 0xce, 0x6e, 0x52, 0x5b, 0x71, 0xd9, 0x6e, 0x45, 0x57, 0x84, 0xbc, 0xac,
+    0x01, 0x25, 0x08, 0xba, 0x39, 0xb4, 0x43, 0x31, 0x8b, 0x63, 0xf8, 0x22, 0xc3, 0xc7, 0xeb, 0xdb,
+    0xc9, 0xa8, 0xec, 0xa0, 0x7c, 0x65, 0x9f, 0x35, 0x5f, 0x93, 0x96, 0x7b, 0xec, 0xcc, 0x11, 0xcd,
+    0x05, 0xa4, 0xbd, 0xc9, 0x76, 0x42, 0x07, 0x57, 0xdf, 0xa7, 0xac, 0xa8, 0x96, 0x0f, 0x34, 0x35,
+    0x10, 0x83, 0x58, 0x4e, 0xd9, 0x38, 0x19, 0x5f, 0x30, 0x6f, 0xc2, 0xfe, 0x76, 0x05, 0x4b, 0x51,
+    0x4c, 0x59, 0xfc, 0x25, 0xad, 0x8d, 0xd9, 0x0c, 0x26, 0xfe, 0xc6, 0x01, 0x2e, 0x28, 0x22, 0xfd,
+    0x38, 0x65, 0xdd, 0xdb, 0x5f, 0x4f, 0x7a, 0x77, 0x3f, 0x71, 0x86, 0x4d, 0x46, 0xfe, 0x65, 0x36,
+    0x79, 0xd0, 0x30, 0x6a, 0x6c, 0x76, 0x71, 0xa0, 0x86, 0xdd, 0xb6, 0xdb, 0xb4, 0xac, 0xcd, 0xc4,
+    0xaa, 0x4f, 0x4a, 0x6b, 0xdc, 0x21, 0xf7, 0x09, 0xe0, 0xd8, 0xf6, 0x34, 0x93, 0xe0, 0xf6, 0x9f,
+    0x0f, 0x7f, 0x00, 0xa7, 0x96, 0xb8, 0x19, 0x94, 0x10, 0x00, 0x00,
+};
+
+#endif // DASHBOARD_H
+
+/*** End of dashboard.h ***/
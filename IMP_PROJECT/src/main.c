@@ -6,67 +6,1071 @@
  */
 
 #include <stdio.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
-#include "driver/adc.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
 #include <esp_wifi.h>
 #include <esp_http_server.h>
 #include <esp_system.h>
 #include <esp_event.h>
 #include <nvs_flash.h>
+#include "esp_mac.h"
+#include "esp_partition.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
 #include "rtc.h"
 #include "driver/rtc_io.h"
 #include "esp_sleep.h"
+#include "ulp.h"
+#include "ulp_adc.h"
 #include <math.h>
 #include <sys/time.h>
-#include <lwip/apps/sntp.h>
+#include "esp_sntp.h"
 #include "esp_http_client.h"
 #include <string.h>
 #include "esp_wifi.h"
 #include "esp_log.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
-#include "cJSON.h"
+#include "dashboard.h"
+#include "pipeline.h"
+#include "memory_budget.h"
 
 /************************ MACROS AND GLOBAL VARIABLES ************************/
 
 // adc 
-#define GPIO_39 ADC1_CHANNEL_3 // gpio39 on adc
+#define CHANNEL_COUNT 1 // count of channels in channel table, at most CHANNEL_COUNT_MAX
+#define ADC_SAMPLE_RATE_DEFAULT_HZ 20000 // default rate of continuous conversions, lowest rate supported by ESP32
+#define ADC_SAMPLE_RATE_MIN_HZ 20000 // lowest rate of continuous conversions supported by ESP32
+#define ADC_SAMPLE_RATE_MAX_HZ 200000 // highest rate of continuous conversions, count of conversions of bank fits 32 bits within SAMPLE_PERIOD_MAX_MS
+#define ADC_FRAME_SIZE 256 // bytes of conversion results delivered by one DMA frame
+#define ADC_POOL_SIZE 1024 // bytes of driver result pool
+#define ADC_MEDIAN_FRAMES 64 // count of last frame means used by median filter
+#define ADC_FILTER_AVERAGE 0 // output sample is average of all conversions in period
+#define ADC_FILTER_MEDIAN 1 // output sample is median of last frame means in period
+#define ADC_FILTER_DEFAULT ADC_FILTER_AVERAGE // default decimation filter
+
+typedef struct {
+    uint64_t sum[CHANNEL_COUNT]; // sum of conversions of every channel, 32 bits overflow after 52 s at full scale
+    uint32_t count[CHANNEL_COUNT]; // count of conversions of every channel
+    uint16_t frame_means[CHANNEL_COUNT][ADC_MEDIAN_FRAMES]; // ring of frame means with ADC_FRACTION_BITS of every channel
+    uint32_t frames[CHANNEL_COUNT]; // count of frames of every channel, 16 bits wrap within SAMPLE_PERIOD_MAX_MS
+} adc_bank_t;
+
+adc_continuous_handle_t adc_handle = NULL; // continuous adc driver
+adc_bank_t adc_banks[2]; // ping-pong accumulators, one filled by DMA callback and one read by sampler
+volatile uint8_t adc_active_bank = 0; // bank filled by DMA callback
+portMUX_TYPE adc_bank_lock = portMUX_INITIALIZER_UNLOCKED; // guards swap of banks
+RTC_DATA_ATTR uint8_t adc_filter = ADC_FILTER_DEFAULT; // decimation filter, setting filter of /config
+RTC_DATA_ATTR uint32_t adc_sample_rate_hz = ADC_SAMPLE_RATE_DEFAULT_HZ; // rate of continuous conversions, setting rate of /config
+const char *adc_filter_names[] = {"average", "median"}; // name of every ADC_FILTER_* filter
+int8_t adc_channel_index[CHANNEL_COUNT_MAX]; // index in channel table of every ADC1 channel, -1 if channel is not scanned
 #define GPIO_LED 4 // gpio port where led is connected
 
-// wifi access point
+// wifi
 #define WIFI_SSID "ESP32" // wifi access point name
+#define WIFI_AP_MAX_CONNECTIONS 10 // maximal count of stations connected to access point
+#define WIFI_STA_SSID "TP-LINK_8DBC" // default name of upstream network
+#define WIFI_STA_PASSWORD "38599279" // default password of upstream network
+char wifi_sta_ssid[33] = WIFI_STA_SSID; // name of upstream network
+char wifi_sta_password[65] = WIFI_STA_PASSWORD; // password of upstream network
+#define WIFI_RECONNECT_DELAY_MS 5000 // delay of reconnection of station, scanning moves radio away from channel of access point
+esp_timer_handle_t wifi_reconnect_timer = NULL; // timer which reconnects station
+
+// web server
+httpd_handle_t server = NULL; // web server
+#define RESPONSE_FORMAT_JSON 0 // json response
+#define RESPONSE_FORMAT_CSV 1 // csv response
+#define RESPONSE_FORMAT_BINARY 2 // packed little-endian records
+#define WS_MAX_CLIENTS 16 // maximal count of sockets checked for websocket subscribers
+#define HTTPD_MAX_URI_HANDLERS 16 // capacity of endpoint table, default of 8 is full
+#define HTTPD_TASK_PRIORITY 5 // priority of httpd task, short requests are handled directly by it
+#define HTTPD_TASK_CORE 0 // core where httpd task and its workers run, together with wifi
+#define HTTPD_MAX_OPEN_SOCKETS 7 // at most CONFIG_LWIP_MAX_SOCKETS - 3, least recently used socket is closed when all are taken
+#define HTTPD_KEEP_ALIVE_IDLE_S 10 // idle time of connection before first tcp keep-alive probe
+#define HTTPD_KEEP_ALIVE_INTERVAL_S 5 // time between tcp keep-alive probes
+#define HTTPD_KEEP_ALIVE_COUNT 3 // count of unanswered probes before connection is closed
+#define HTTPD_WORKER_PRIORITY 3 // priority of worker tasks, below httpd task so long requests do not delay short ones
+#define ENDPOINT_PRIORITY_HIGH 0 // endpoint is handled directly by httpd task
+#define ENDPOINT_PRIORITY_LOW 1 // endpoint is handed over to worker task
+
+typedef struct {
+    esp_err_t (*handler)(httpd_req_t *req); // handler of endpoint
+    uint8_t metrics_uri; // index of endpoint in metrics
+    uint8_t priority; // ENDPOINT_PRIORITY_HIGH or ENDPOINT_PRIORITY_LOW
+} endpoint_t;
+
+endpoint_t endpoints[HTTPD_MAX_URI_HANDLERS]; // registered endpoints, passed to handlers as user context
+uint8_t endpoint_count = 0; // count of registered endpoints
+QueueHandle_t httpd_worker_queue = NULL; // asynchronous copies of requests waiting for worker
+SemaphoreHandle_t httpd_workers_ready = NULL; // count of idle workers
+TaskHandle_t httpd_worker_handles[HTTPD_WORKER_COUNT] = {NULL}; // worker tasks
+TaskHandle_t httpd_task_handle = NULL; // httpd task, known after first request
+#if STATIC_ALLOCATION
+StackType_t httpd_worker_stacks[HTTPD_WORKER_COUNT][HTTPD_WORKER_STACK_SIZE]; // stacks of worker tasks
+StaticTask_t httpd_worker_buffers[HTTPD_WORKER_COUNT]; // control blocks of worker tasks
+uint8_t httpd_worker_queue_storage[HTTPD_WORKER_COUNT * sizeof(httpd_req_t *)]; // items of worker queue
+StaticQueue_t httpd_worker_queue_buffer; // control block of worker queue
+StaticSemaphore_t httpd_workers_ready_buffer; // control block of idle workers semaphore
+#endif
+atomic_bool ws_broadcast_pending = false; // broadcast of last sample is queued in httpd task
+
+#define HISTORY_LIMIT_DEFAULT 1000 // default count of returned samples or buckets of history query
+#define HISTORY_LIMIT_MAX 100000 // maximal count of returned samples or buckets of history query
+
+typedef struct {
+    response_writer_t *writer; // response
+    uint8_t format; // response format
+    uint32_t to; // timestamp of last returned record
+    uint32_t step; // length of downsampling bucket in seconds, 0 returns raw records
+    uint32_t limit; // maximal count of returned records or buckets
+    uint8_t channel; // index of returned channel
+    uint32_t count; // count of returned records or buckets
+    uint32_t bucket_start; // start of current bucket
+    int16_t bucket_min; // minimum of current bucket
+    int16_t bucket_max; // maximum of current bucket
+    int64_t bucket_sum; // sum of current bucket
+    uint32_t bucket_count; // count of samples in current bucket, 0 if there is no bucket
+} history_query_t;
 
 // temperature
-double temperature = 0.0; // actual temperature 
-char temperature_arr[10][48] = {'\0'}; // last 10 temperatures
+#define TEMPERATURE_INVALID INT16_MIN // centi-degrees of channel without conversions
+double temperature[CHANNEL_COUNT]; // actual temperature of every channel, NAN if channel has no conversions, owned by sampler task
+
+// temperature conversion
+#define CONVERSION_EXACT 0 // quadratic formula evaluated in double precision
+#define CONVERSION_LUT 1 // lookup table, fraction bits of raw value are dropped
+#define CONVERSION_LUT_INTERPOLATED 2 // lookup table with linear interpolation between entries
+#define CONVERSION_DEFAULT CONVERSION_LUT_INTERPOLATED // default conversion mode
+RTC_DATA_ATTR uint8_t conversion_mode = CONVERSION_DEFAULT; // conversion mode, exact mode is kept for validation of table, kept during deep sleep
+const char *conversion_mode_names[] = {"exact", "lut", "interpolated"}; // name of every CONVERSION_* mode
+
+// adc calibration, eFuse characterization of chip is combined with temperature_lut once at startup
+#define ADC_DEFAULT_VREF_MV 1100 // reference voltage used when eFuse of chip has no calibration
+#define ADC_ATTEN_COUNT 4 // count of ADC attenuations
+#define ADC_CALI_TABLES (CHANNEL_COUNT < ADC_ATTEN_COUNT ? CHANNEL_COUNT : ADC_ATTEN_COUNT) // count of calibrated tables, enough for every channel to have its own attenuation
+adc_cali_handle_t adc_cali_handles[ADC_ATTEN_COUNT] = {NULL}; // line fitting characterization of every used attenuation
+int16_t calibrated_luts[ADC_CALI_TABLES][LUT_SIZE]; // temperature in centi-degrees for every raw code
+int8_t calibrated_lut_index[ADC_ATTEN_COUNT] = {-1, -1, -1, -1}; // table of every attenuation, -1 if attenuation is not calibrated
+
+typedef struct {
+    int64_t time_us; // time of sample in microseconds (UTC)
+    int16_t temperature[CHANNEL_COUNT]; // temperature of every channel in centi-degrees, TEMPERATURE_INVALID if channel has no value
+} sample_t;
+
+// tasks
+#define SAMPLE_PERIOD_MS 2000 // default period of sampling
+#define SAMPLE_PERIOD_MIN_MS 500 // shortest period of sampling
+#define SAMPLE_PERIOD_MAX_MS 3600000 // longest period of sampling
+#define SAMPLE_ADAPTIVE_MAX_DEFAULT_MS 60000 // default longest period of adaptive sampling
+#define SAMPLE_ADAPTIVE_STEP 0.2 // change of temperature between samples in degrees which adaptive sampling keeps
+#define SAMPLE_ADAPTIVE_MARGIN 2.0 // distance from threshold in degrees, added to hysteresis, where adaptive sampling uses shortest period
+#define SAMPLE_ADAPTIVE_BACKOFF 1.25 // growth of period per stable sample
+RTC_DATA_ATTR uint32_t sample_period_ms = SAMPLE_PERIOD_MS; // period of fixed sampling, also first period of adaptive sampling
+RTC_DATA_ATTR bool adaptive_sampling = false; // period follows rate of change of temperature and distance from threshold
+RTC_DATA_ATTR uint32_t adaptive_period_min_ms = SAMPLE_PERIOD_MIN_MS; // shortest period of adaptive sampling
+RTC_DATA_ATTR uint32_t adaptive_period_max_ms = SAMPLE_ADAPTIVE_MAX_DEFAULT_MS; // longest period of adaptive sampling
+RTC_DATA_ATTR uint32_t current_period_ms = SAMPLE_PERIOD_MS; // period until next sample
+RTC_DATA_ATTR double schedule_last_temperature[CHANNEL_COUNT]; // temperature of every channel at last schedule
+RTC_DATA_ATTR bool schedule_last_valid[CHANNEL_COUNT]; // schedule_last_temperature of channel is valid
+#define SAMPLER_TASK_CORE 1 // core where sampler task runs
+#define STORAGE_TASK_CORE 0 // core where storage task runs, together with wifi and httpd
+#define SAMPLER_TASK_PRIORITY 6 // priority of sampler task
+#define STORAGE_TASK_PRIORITY 4 // priority of storage task
+TaskHandle_t sampler_task_handle = NULL; // sampler task
+TaskHandle_t storage_task_handle = NULL; // storage task
+#if STATIC_ALLOCATION
+StackType_t sampler_task_stack[SAMPLER_STACK_SIZE]; // stack of sampler task
+StaticTask_t sampler_task_buffer; // control block of sampler task
+StackType_t storage_task_stack[STORAGE_STACK_SIZE]; // stack of storage task
+StaticTask_t storage_task_buffer; // control block of storage task
+#endif
+
+// sample queue between sampler and storage task
+sample_t sample_queue[SAMPLE_QUEUE_SIZE]; // samples waiting for storage
+atomic_uint sample_queue_head = 0; // count of pushed samples, written only by sampler task
+atomic_uint sample_queue_tail = 0; // count of popped samples, written only by storage task
+uint32_t dropped_samples = 0; // count of samples dropped because queue was full
 
 // threshold
 #define THRESHOLD_DEFAULT_VALUE -50.0 // default value of threshold
-double threshold = THRESHOLD_DEFAULT_VALUE; // threshold value
-bool threshold_overcome = false; // variable which indicates if threshold can be overcommed
+RTC_DATA_ATTR bool threshold_overcome = false; // variable which indicates if threshold of any channel is overcome, level of led
+#define THRESHOLD_HYSTERESIS_DEFAULT 1.0 // default width of band below threshold where led stays on
+RTC_DATA_ATTR double threshold_hysteresis = THRESHOLD_HYSTERESIS_DEFAULT; // hysteresis of threshold
+#define THRESHOLD_INPUT_TEMPERATURE 0 // threshold is compared with last temperature
+#define THRESHOLD_INPUT_EWMA 1 // threshold is compared with exponentially weighted moving average of temperature
+#define THRESHOLD_INPUT_DEFAULT THRESHOLD_INPUT_TEMPERATURE // default input of threshold
+RTC_DATA_ATTR uint8_t threshold_input = THRESHOLD_INPUT_DEFAULT; // input of threshold
+
+// alerts, rule table is evaluated with every sample, changes of alerts are pushed to websocket clients and uplink
+#define ALERT_NOTIFY_INTERVAL_US 60000000LL // shortest time between notifications of one rule, changes within it are coalesced
+
+typedef struct {
+    uint32_t sequence; // sequence number of notification
+    uint32_t timestamp; // time of notification in seconds
+    int16_t value; // temperature or rate in centi-degrees, TEMPERATURE_INVALID without value
+    uint8_t rule; // index of rule
+    uint8_t type; // type of rule
+    uint8_t channel; // channel of rule
+    bool active; // alert was raised, released otherwise
+} alert_event_t;
+
+typedef struct {
+    alert_rule_t rules[ALERT_RULES_MAX]; // rule table with fields of request
+    uint8_t rule; // rule of fields without rule suffix
+} alert_update_t;
+
+const char *alert_type_names[] = {"off", "above", "below", "rate", "stale"}; // name of every ALERT_* type
+RTC_DATA_ATTR alert_rule_t alert_rules[ALERT_RULES_MAX]; // rule table, zeroed rule is ALERT_OFF
+RTC_DATA_ATTR alert_state_t alert_states[ALERT_RULES_MAX]; // evaluation state of every rule
+RTC_DATA_ATTR bool alert_notified[ALERT_RULES_MAX]; // state of every rule in its last notification
+RTC_DATA_ATTR int64_t alert_notified_us[ALERT_RULES_MAX]; // monotonic time of last notification of every rule, 0 if rule was not notified
+RTC_DATA_ATTR alert_event_t alert_events[ALERT_EVENTS_SIZE]; // ring of last notifications
+RTC_DATA_ATTR uint32_t alert_event_count = 0; // count of notifications, sequence number of next one
+RTC_DATA_ATTR uint32_t ws_alert_sent = 0; // count of notifications sent to websocket clients, written only by httpd task
+RTC_DATA_ATTR uint32_t uplink_alert_sent = 0; // count of notifications posted to uplink, written only by telemetry task
+atomic_bool ws_alert_pending = false; // broadcast of notifications is queued in httpd task
+portMUX_TYPE alert_lock = portMUX_INITIALIZER_UNLOCKED; // guards rule table, states and notifications
+char* alert_memory_blob = "alerts"; // key of alert rules blob in settings memory
+alert_rule_t alert_rules_saved[ALERT_RULES_MAX]; // rules last written to memory
+
+// channels
+typedef struct {
+    adc_channel_t adc_channel; // channel of ADC1
+    uint8_t gpio; // gpio where sensor is connected
+    adc_atten_t atten; // attenuation of channel
+    double gain; // calibration, converted temperature is multiplied by gain
+    double offset; // calibration, degrees added to converted temperature
+    double threshold; // threshold value
+    bool threshold_overcome; // threshold of channel is overcome
+} channel_t;
+
+// channel table, all channels are converted in one DMA scan, thresholds are kept during deep sleep
+RTC_DATA_ATTR channel_t channels[CHANNEL_COUNT] = {
+    {
+        .adc_channel = ADC_CHANNEL_3,
+        .gpio = 39,
+        .atten = ADC_ATTEN_DB_11,
+        .gain = 1.0,
+        .offset = 0.0,
+        .threshold = THRESHOLD_DEFAULT_VALUE,
+    },
+};
+// guards thresholds, calibration and threshold states of channel table and threshold_hysteresis,
+// doubles are written by settings on core of httpd while sampler reads them on its own core
+portMUX_TYPE channel_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ulp coprocessor, checks threshold of first channel during deep sleep and wakes main cpu only on crossing
+#define ULP_CHECK_PERIOD_MS 100 // period of threshold check by ulp
+#define ULP_RAW_ON 0 // word in RTC slow memory with raw value where threshold is overcome
+#define ULP_RAW_OFF 1 // word in RTC slow memory with raw value where overcome threshold is released
+#define ULP_STATE 2 // word in RTC slow memory with threshold state evaluated by ulp
+#define ULP_LAST_RAW 3 // word in RTC slow memory with last raw value measured by ulp
+#define ULP_PROGRAM_OFFSET 4 // word in RTC slow memory where ulp program starts
+#define ULP_LABEL_OVERCOME 1 // ulp program label, threshold is overcome
+#define ULP_LABEL_RELEASE 2 // ulp program label, overcome threshold is released
+#define ULP_LABEL_DONE 3 // ulp program label, end of check
 
 // time
-time_t t = 0; // actual time
-char time_as_string[64]; // actual time as string
+#define TIMEZONE_OFFSET_S 3600 // ours time zone, applied only when time is formatted
+#define TIME_NTP_SERVER "sk.pool.ntp.org" // default sntp server
+char ntp_server[64] = TIME_NTP_SERVER; // sntp server, sntp keeps pointer to it
+#define TIME_VALID_EPOCH 1451606400 // 2016-01-01, older timestamps are RTC time taken before time synchronization
+#define TIME_VALID_EPOCH_US ((int64_t)TIME_VALID_EPOCH * 1000000) // TIME_VALID_EPOCH in microseconds
+#define TIME_RESYNC_INTERVAL_MS 900000 // period of sntp resynchronization
+#define TIME_STEP_THRESHOLD_US 2000000 // larger errors are stepped at once, smaller are slewed
+#define TIME_SLEW_PPM 500 // maximal rate of slewed correction, same as adjtime()
+#define TIME_RATE_LIMIT_PPB 500000 // maximal frequency correction of esp_timer
+
+typedef struct {
+    int64_t base_mono_us; // esp_timer time of anchor
+    int64_t base_wall_us; // wall-clock time (UTC) at anchor, 0 until time is synchronized
+    uint64_t base_rtc_us; // RTC time of anchor, used to carry time over deep sleep
+    int64_t slew_us; // correction which is slewed in after anchor
+    int32_t rate_ppb; // frequency correction of esp_timer estimated from resynchronizations
+    int64_t last_sync_mono_us; // esp_timer time of last synchronization
+    int64_t monotonic_offset_us; // monotonic time at esp_timer time 0 of this boot, carried over deep sleep and reset by RTC
+} timebase_t;
+
+RTC_DATA_ATTR timebase_t timebase = {0}; // monotonic timebase disciplined by sntp, kept during deep sleep
+portMUX_TYPE time_lock = portMUX_INITIALIZER_UNLOCKED; // guards timebase, written from sntp callback
+
+// low power
+#define LOW_POWER_DEFAULT false // default of deep sleep between samples, mode is setting low_power of /config
+#define WAKE_BUTTON_GPIO 0 // boot button, wakes device with wifi and web server while held low
+#define AWAKE_TIME_MS 120000 // time wifi and web server stay up after wake by button
+#define UPLINK_BOOT_TIMEOUT_MS 30000 // longest time of network boot, device returns to deep sleep even if uplink was not drained
+#define UPLINK_BOOT_RETRY_MS 1000 // time between uplink attempts of network boot, station is usually connected within few seconds
+#define LOW_POWER_ADC_WINDOW_MS 20 // time of continuous conversions for one sample after wake
+RTC_DATA_ATTR bool low_power_mode = LOW_POWER_DEFAULT; // sample in deep sleep duty cycle
+RTC_DATA_ATTR uint64_t next_sample_rtc_us = 0; // RTC time of next sample in deep sleep duty cycle
+esp_timer_handle_t awake_timer = NULL; // timer which returns device to deep sleep
+bool uplink_boot = false; // device was woken in low power mode only to drain uplink
+
+// record log
+#define LOG_PARTITION_LABEL "templog" // label of raw flash partition with records
+#define LOG_PARTITION_SUBTYPE 0x40 // custom data subtype of record log partition
+#define LOG_SECTOR_SIZE 4096 // size of erasable flash sector
+#define LOG_SECTOR_MAGIC 0x4B4C4254 // "TBLK", marks initialized sector with encoded blocks
+#define LOG_BATCH_MAX_RECORDS LOG_BLOCK_MAX_RECORDS // capacity of RAM staging buffer, flushed as one block
+#define LOG_BATCH_SIZE_DEFAULT 32 // default count of records flushed to flash at once
+#define LOG_COMMIT_INTERVAL_DEFAULT_MS 60000 // default maximal time records wait in RAM
+#define LOG_BATCH_MAGIC 0x33435442 // "BTC3", marks valid staging buffer after reset
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic; // LOG_SECTOR_MAGIC
+    uint32_t sequence; // sector sequence number, increments with every started sector
+} log_sector_header_t;
+
+#define LOG_BLOCK_FREE 0xFFFF // length of erased flash
+#define LOG_SECTOR_DATA_START sizeof(log_sector_header_t) // offset of first block in sector
+#define LOG_MAX_SECTORS 256 // maximal count of sectors in time index
+
+typedef struct {
+    uint32_t sector; // sector which is read
+    size_t offset; // offset of next block in sector
+    size_t limit; // end of blocks in sector
+    uint8_t block[LOG_BLOCK_MAX_SIZE]; // block which is decoded
+    log_block_decoder_t decoder; // decoder of block
+    bool decoding; // decoder has block
+} log_sector_reader_t;
+
+typedef struct {
+    uint32_t sequence; // sequence number of sector
+    uint32_t first_timestamp; // timestamp of first record in sector, UINT32_MAX if sector is empty or invalid
+} log_index_entry_t;
+
+// position of record in log, sector of every sequence number has its own range of positions
+#define LOG_POSITION_STRIDE 4096 // more than count of records in one sector, every record takes at least one byte
+#define LOG_POSITION(sequence, index) ((uint64_t)(sequence) * LOG_POSITION_STRIDE + (index))
+
+// record visitor, returns false to stop visiting
+typedef bool (*log_visitor_t)(const log_record_t *record, void *ctx);
+
+const esp_partition_t *log_partition = NULL; // partition with records
+uint32_t log_sector_count = 0; // count of sectors in partition
+uint32_t log_head_sector = 0; // sector which is currently written
+uint32_t log_head_sequence = 0; // sequence number of head sector
+size_t log_head_offset = LOG_SECTOR_DATA_START; // offset of free space in head sector
+uint32_t log_head_count = 0; // count of records in head sector
+log_index_entry_t log_index[LOG_MAX_SECTORS]; // sparse time index, one entry per sector
+
+typedef struct {
+    uint32_t magic; // LOG_BATCH_MAGIC
+    uint16_t count; // count of records in buffer
+    log_record_t records[LOG_BATCH_MAX_RECORDS]; // records waiting for write to flash
+} log_batch_t;
+
+// staging buffer is kept in RTC memory which is not initialized on reset,
+// so records buffered before panic, watchdog or brownout reset are written at next boot
+RTC_NOINIT_ATTR log_batch_t log_batch;
+RTC_DATA_ATTR uint16_t log_batch_size = LOG_BATCH_SIZE_DEFAULT; // count of records flushed to flash at once, setting batch of /config
+RTC_DATA_ATTR uint32_t log_commit_interval_ms = LOG_COMMIT_INTERVAL_DEFAULT_MS; // maximal time records wait in RAM, setting commit_interval of /config
+uint32_t dropped_records = 0; // count of records dropped because flash writes failed and staging buffer was full
+SemaphoreHandle_t log_mutex = NULL; // guards staging buffer and head of log
+#if STATIC_ALLOCATION
+StaticSemaphore_t log_mutex_buffer; // control block of log mutex
+#endif
+esp_timer_handle_t log_commit_timer = NULL; // timer for periodic flush of staging buffer
+
+// rollup tiers, min/max/avg of fixed periods in their own rings of sectors at end of record log partition,
+// every tier is fed by closed periods of previous tier, first tier by samples with synchronized time
+#define ROLLUP_TIERS 2 // count of rollup tiers
+#define ROLLUP_MINUTE_PERIOD_S 60 // period of first tier
+#define ROLLUP_MINUTE_RETENTION_S 86400 // time kept by first tier
+#define ROLLUP_QUARTER_PERIOD_S 900 // period of second tier
+#define ROLLUP_QUARTER_RETENTION_S (30 * 86400) // time kept by second tier
+#define ROLLUP_SECTOR_MAGIC 0x4C525254U // "TRRL", marks initialized sector of rollup tier, tier index is added
+#define ROLLUP_FREE UINT32_MAX // timestamp of erased flash
+#define ROLLUP_READ_RECORDS 16 // count of records read from flash at once
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp; // start of period in seconds
+    int16_t min; // minimum in centi-degrees
+    int16_t max; // maximum in centi-degrees
+    int16_t average; // average in centi-degrees
+    uint16_t count; // count of samples, saturated
+    uint8_t channel; // index of channel in channel table
+} rollup_record_t;
+
+#define ROLLUP_SECTOR_RECORDS ((LOG_SECTOR_SIZE - LOG_SECTOR_DATA_START) / sizeof(rollup_record_t)) // count of records in one sector
+// sectors of tier, one more sector than retention needs because oldest sector is erased as whole
+#define ROLLUP_SECTORS(period_s, retention_s) (((retention_s) / (period_s) * CHANNEL_COUNT + ROLLUP_SECTOR_RECORDS - 1) / ROLLUP_SECTOR_RECORDS + 1)
+#define ROLLUP_MAX_SECTORS ROLLUP_SECTORS(ROLLUP_QUARTER_PERIOD_S, ROLLUP_QUARTER_RETENTION_S) // sectors of largest tier
+
+typedef struct {
+    uint32_t period; // length of period in seconds
+    uint32_t sector_count; // count of sectors in ring, 0 if tier does not fit partition
+    uint32_t first_sector; // sector of partition where ring starts
+    uint32_t head_sector; // sector of ring which is currently written
+    uint32_t head_sequence; // sequence number of head sector
+    uint32_t head_count; // count of records in head sector
+    log_index_entry_t index[ROLLUP_MAX_SECTORS]; // time index, one entry per sector of ring
+} rollup_tier_t;
+
+typedef struct {
+    uint32_t start; // start of period
+    int16_t min; // minimum of period
+    int16_t max; // maximum of period
+    int64_t sum; // sum of samples of period
+    uint32_t count; // count of samples of period, 0 if period is not open
+} rollup_bucket_t;
+
+// rollup visitor, returns false to stop visiting
+typedef bool (*rollup_visitor_t)(const rollup_record_t *record, void *ctx);
+
+rollup_tier_t rollup_tiers[ROLLUP_TIERS] = {
+    {.period = ROLLUP_MINUTE_PERIOD_S},
+    {.period = ROLLUP_QUARTER_PERIOD_S},
+}; // rollup tiers, finest first
+const uint32_t rollup_tier_sectors[ROLLUP_TIERS] = {
+    ROLLUP_SECTORS(ROLLUP_MINUTE_PERIOD_S, ROLLUP_MINUTE_RETENTION_S),
+    ROLLUP_SECTORS(ROLLUP_QUARTER_PERIOD_S, ROLLUP_QUARTER_RETENTION_S),
+}; // count of sectors of every tier
+RTC_DATA_ATTR rollup_bucket_t rollup_buckets[ROLLUP_TIERS][CHANNEL_COUNT]; // open period of every tier and channel, kept during deep sleep
+
+// telemetry uplink
+#define UPLINK_URL "" // default url where batches of records are posted, e.g. "http://192.168.0.100:8080/telemetry", empty disables uplink
+#define UPLINK_INTERVAL_MS 30000 // default time between uplink attempts when all records were sent
+#define UPLINK_TIMEOUT_MS 5000 // timeout of one post
+#define UPLINK_TASK_PRIORITY 2 // priority of telemetry task
+#define UPLINK_TASK_CORE 0 // core where telemetry task runs
+#define UPLINK_PAYLOAD_VERSION 3 // version of payload format, 3 carries blocks of record log
+char* uplink_memory_name = "uplink"; // name of memory with uplink state
+char* uplink_memory_cursor = "cursor"; // key of position of first record not yet acknowledged by server
+uint64_t uplink_cursor = 0; // position of first record not yet acknowledged by server
+TaskHandle_t telemetry_task_handle = NULL; // telemetry task
+#if STATIC_ALLOCATION
+StackType_t telemetry_task_stack[TELEMETRY_STACK_SIZE]; // stack of telemetry task
+StaticTask_t telemetry_task_buffer; // control block of telemetry task
+#endif
+RTC_DATA_ATTR char uplink_url[128] = UPLINK_URL; // url where batches of records are posted, empty disables uplink, kept during deep sleep
+RTC_DATA_ATTR uint32_t uplink_interval_ms = UPLINK_INTERVAL_MS; // time between uplink attempts when all records were sent, also between network boots
+RTC_DATA_ATTR uint32_t uplink_unsent_records = 0; // count of records stored by low power cycles since uplink caught up
+RTC_DATA_ATTR uint64_t uplink_last_rtc_us = 0; // RTC time of last network boot
+
+// settings, globals are working copy and blob in memory is written back with debounce
+#define SETTINGS_VERSION 5 // version of settings blob, blob of other version or size is ignored
+#define SETTINGS_SAVE_DELAY_MS 5000 // time without change before settings are written
+#define REQUEST_RECV_RETRIES 3 // count of receive timeouts before request is dropped
+
+typedef struct {
+    uint16_t version; // SETTINGS_VERSION
+    uint16_t size; // size of settings_t
+    double threshold[CHANNEL_COUNT]; // threshold of every channel
+    double gain[CHANNEL_COUNT]; // calibration gain of every channel
+    double offset[CHANNEL_COUNT]; // calibration offset of every channel
+    double hysteresis; // hysteresis of threshold
+    uint8_t threshold_input; // input of threshold
+    bool adaptive_sampling; // adaptive sampling
+    uint32_t sample_period_ms; // period of sampling
+    uint32_t adaptive_period_min_ms; // shortest period of adaptive sampling
+    uint32_t adaptive_period_max_ms; // longest period of adaptive sampling
+    char wifi_ssid[33]; // name of upstream network
+    char wifi_password[65]; // password of upstream network
+    char ntp_server[64]; // sntp server
+    char uplink_url[128]; // url of uplink
+    uint32_t uplink_interval_ms; // time between uplink attempts
+    uint8_t conversion_mode; // conversion of raw values to temperature
+    bool low_power_mode; // deep sleep duty cycle
+    uint16_t log_batch_size; // count of records flushed to flash at once
+    uint32_t log_commit_interval_ms; // maximal time records wait in RAM
+    uint8_t adc_filter; // decimation filter
+    uint32_t adc_sample_rate_hz; // rate of continuous conversions
+} settings_t;
+
+typedef struct {
+    settings_t settings; // working settings with fields of request
+    uint8_t channel; // channel of fields without channel suffix
+} settings_update_t;
+
+char* settings_memory_name = "settings"; // name of memory with settings
+char* settings_memory_blob = "blob"; // key of settings blob
+settings_t settings_saved; // settings last written to memory, unchanged settings are not written again
+esp_timer_handle_t settings_timer = NULL; // debounce timer of settings write
+
+// live state, written only by sampler task and read by httpd handlers
+sample_t live_sample = {0}; // last sample
+sample_t history[HISTORY_SIZE]; // ring of most recent samples
+uint16_t history_head = 0; // position where next sample is written
+uint16_t history_count = 0; // count of samples in history
+atomic_uint live_sequence = 0; // sequence lock of live state, odd while live state is updated
+
+// records loaded from memory at boot
+typedef struct {
+    log_record_t records[HISTORY_SIZE * CHANNEL_COUNT]; // ring of last visited records
+    uint16_t head; // position where next record is written
+    uint16_t count; // count of records in ring
+} history_load_t;
+
+// rolling statistics, every window is ring of buckets which moves by one bucket,
+// moving average and first window are kept during deep sleep, longer windows are too large for RTC memory
+#define STATS_WINDOWS 3 // count of statistics windows
+#define STATS_RTC_WINDOWS 1 // count of first windows kept in RTC memory
+#define STATS_BUCKETS 30 // count of buckets of one window
+#define STATS_EWMA_ALPHA 0.1 // weight of new sample in exponentially weighted moving average
+const uint32_t stats_window_s[STATS_WINDOWS] = {60, 3600, 86400}; // length of every window in seconds
+
+// sum and count of longest bucket at SAMPLE_PERIOD_MIN_MS fit 32 and 16 bits
+typedef struct __attribute__((packed)) {
+    int32_t sum; // sum of centi-degrees
+    int64_t sum_squares; // sum of squared centi-degrees
+    uint16_t count; // count of samples
+    int16_t min; // minimum in centi-degrees
+    int16_t max; // maximum in centi-degrees
+} stats_bucket_t;
+
+typedef struct {
+    stats_bucket_t buckets[STATS_BUCKETS]; // ring of buckets
+    uint32_t current; // number of newest bucket, buckets are counted in monotonic time
+} stats_window_t;
+
+typedef struct {
+    stats_window_t windows[STATS_RTC_WINDOWS]; // first windows of channel
+    double ewma; // exponentially weighted moving average of temperature, NAN until first sample
+} channel_stats_rtc_t;
+
+typedef struct {
+    stats_window_t windows[STATS_WINDOWS - STATS_RTC_WINDOWS]; // longer windows of channel, cleared by deep sleep
+} channel_stats_t;
+
+typedef struct {
+    uint32_t count; // count of samples in window
+    int16_t min; // minimum in centi-degrees
+    int16_t max; // maximum in centi-degrees
+    double mean; // mean in degrees
+    double variance; // variance in squared degrees
+} stats_summary_t;
+
+RTC_DATA_ATTR channel_stats_rtc_t stats_rtc[CHANNEL_COUNT]; // statistics of every channel kept during deep sleep, written only by sampler task
+channel_stats_t stats[CHANNEL_COUNT]; // longer statistics of every channel, written only by sampler task
+portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED; // guards statistics read by httpd handlers
+
+// all variables kept during deep sleep, stats_rtc is last of them
+RTC_BUDGET_CHECK(sizeof(adc_filter) + sizeof(adc_sample_rate_hz) + sizeof(conversion_mode) + sizeof(sample_period_ms) + sizeof(adaptive_sampling) +
+                 sizeof(adaptive_period_min_ms) + sizeof(adaptive_period_max_ms) + sizeof(current_period_ms) + sizeof(schedule_last_temperature) +
+                 sizeof(schedule_last_valid) + sizeof(threshold_overcome) + sizeof(threshold_hysteresis) + sizeof(threshold_input) +
+                 sizeof(alert_rules) + sizeof(alert_states) + sizeof(alert_notified) + sizeof(alert_notified_us) + sizeof(alert_events) +
+                 sizeof(alert_event_count) + sizeof(ws_alert_sent) + sizeof(uplink_alert_sent) + sizeof(channels) + sizeof(timebase) +
+                 sizeof(low_power_mode) + sizeof(next_sample_rtc_us) + sizeof(log_batch) + sizeof(log_batch_size) + sizeof(log_commit_interval_ms) +
+                 sizeof(rollup_buckets) + sizeof(uplink_url) + sizeof(uplink_interval_ms) + sizeof(uplink_unsent_records) +
+                 sizeof(uplink_last_rtc_us) + sizeof(stats_rtc));
+
+// binary snapshot for machine consumers, fixed little-endian layout, values in centi-degrees,
+// fields without value are TEMPERATURE_INVALID, new fields are only appended with new version
+#define SNAPSHOT_VERSION 1 // version of snapshot layout
+#define SNAPSHOT_THRESHOLD_OVERCOME 0x01 // snapshot flag, threshold of any channel is overcome
+#define SNAPSHOT_TIME_VALID 0x02 // snapshot flag, timestamps are synchronized time, RTC time before synchronization otherwise
+
+typedef struct __attribute__((packed)) {
+    uint32_t count; // count of samples in window
+    int16_t min; // minimum
+    int16_t max; // maximum
+    int16_t mean; // mean
+    uint32_t variance; // variance in squared centi-degrees divided by 100
+} snapshot_window_t;
+
+typedef struct __attribute__((packed)) {
+    int16_t temperature; // last temperature
+    int16_t threshold; // threshold
+    int16_t ewma; // exponentially weighted moving average
+    uint8_t overcome; // threshold is overcome
+    uint8_t reserved; // zero
+    snapshot_window_t windows[STATS_WINDOWS]; // statistics of every window of stats_window_s
+} snapshot_channel_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp; // time of sample in seconds (UTC)
+    int16_t temperature[CHANNEL_COUNT]; // temperature of every channel
+} snapshot_sample_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t version; // SNAPSHOT_VERSION
+    uint8_t channel_count; // count of channels, CHANNEL_COUNT
+    uint8_t window_count; // count of statistics windows, STATS_WINDOWS
+    uint8_t sample_count; // count of valid samples, at most HISTORY_SIZE
+    uint32_t sequence; // count of samples published since boot, also etag of snapshot
+    uint32_t timestamp; // time of last sample in seconds (UTC)
+    uint8_t flags; // SNAPSHOT_* flags
+    uint8_t reserved[3]; // zero
+    snapshot_channel_t channels[CHANNEL_COUNT]; // state of every channel
+    snapshot_sample_t samples[HISTORY_SIZE]; // most recent samples, newest first, unused samples are zero
+} snapshot_t;
+
+// metrics, hot path is instrumented only when compiled with METRICS_ENABLED
+#ifndef METRICS_ENABLED
+#define METRICS_ENABLED 1 // 0 removes all instrumentation and /metrics endpoint
+#endif
+#define METRICS_BUCKETS 12 // count of duration buckets, bucket i counts durations up to 1024 * 4^i cycles, last bucket is +Inf
+
+// measured stages of hot path
+#define METRICS_STAGE_GET_TEMPERATURE 0 // measurement and conversion of all channels
+#define METRICS_STAGE_STORE_TEMPERATURE 1 // copy of sample to staging buffer, includes flush of full batch
+#define METRICS_STAGE_FLASH_WRITE 2 // encoding and write of one block to flash
+#define METRICS_STAGE_NVS_COMMIT 3 // commit of non-volatile storage
+#define METRICS_STAGES 4 // count of measured stages
+
+// counters
+#define METRICS_COUNTER_SAMPLES 0 // count of taken samples
+#define METRICS_COUNTER_FLASH_WRITES 1 // count of blocks written to flash
+#define METRICS_COUNTER_COMMIT_FAILURES 2 // count of failed flash writes and nvs commits
+#define METRICS_COUNTER_MEMORY_CLEARS 3 // count of memory clears
+#define METRICS_COUNTER_BYTES_SENT 4 // count of bytes sent by web server
+#define METRICS_COUNTERS 5 // count of counters
+
+// endpoints, every endpoint has request counter and duration histogram
+#define METRICS_URI_ROOT 0
+#define METRICS_URI_GET_TEMPERATURE 1
+#define METRICS_URI_SET_THRESHOLD 2
+#define METRICS_URI_GET_LAST_10_TEMPERATURES 3
+#define METRICS_URI_HISTORY 4
+#define METRICS_URI_CHANNELS 5
+#define METRICS_URI_STATS 6
+#define METRICS_URI_WS 7
+#define METRICS_URI_METRICS 8
+#define METRICS_URI_SNAPSHOT 9
+#define METRICS_URI_SAMPLING 10
+#define METRICS_URI_GET_CONFIG 11
+#define METRICS_URI_PUT_CONFIG 12
+#define METRICS_URI_GET_ALERTS 13
+#define METRICS_URI_PUT_ALERTS 14
+#define METRICS_URIS 15 // count of endpoints
 
-// memory
-char* memory_name = "temp_mem"; // name of memory
-char* memory_temperature = "t"; // temperature memory key
-char* memory_count = "count"; // count memory key
+typedef struct {
+    uint32_t buckets[METRICS_BUCKETS]; // count of durations of every bucket, not cumulative
+    uint64_t sum; // sum of durations in cycles
+    uint32_t count; // count of durations
+} metrics_histogram_t;
+
+#if METRICS_ENABLED
+const char *metrics_stage_names[METRICS_STAGES] = {"get_temperature", "store_temperature", "flash_write", "nvs_commit"}; // label of every stage
+const char *metrics_uri_names[METRICS_URIS] = {
+    "/", "/get_temperature", "/set_threshold", "/get_last_10_temperatures", "/history", "/channels", "/stats", "/ws", "/metrics", "/snapshot.bin", "/sampling", "GET /config", "PUT /config",
+    "GET /alerts", "PUT /alerts"
+}; // label of every endpoint
+metrics_histogram_t metrics_stages[METRICS_STAGES]; // duration of every stage
+metrics_histogram_t metrics_uris[METRICS_URIS]; // duration of every endpoint handler
+atomic_uint metrics_counters[METRICS_COUNTERS]; // counters
+portMUX_TYPE metrics_lock = portMUX_INITIALIZER_UNLOCKED; // guards histograms
+
+// cycle counter is read at start and end of measured code, difference is correct across one overflow
+#define METRICS_START(start) uint32_t start = esp_cpu_get_cycle_count()
+#define METRICS_STOP(histogram, start) metrics_observe(&(histogram), esp_cpu_get_cycle_count() - (start))
+#define METRICS_STAGE_STOP(stage, start) METRICS_STOP(metrics_stages[stage], start)
+#define METRICS_COUNT(counter, value) atomic_fetch_add_explicit(&metrics_counters[counter], (value), memory_order_relaxed)
+#else
+#define METRICS_START(start)
+#define METRICS_STOP(histogram, start) ((void)0)
+#define METRICS_STAGE_STOP(stage, start) ((void)0)
+#define METRICS_COUNT(counter, value) ((void)0)
+#endif
 
 // error handling
 esp_err_t err;
 
+/************************ METRICS ************************/
+
+#if METRICS_ENABLED
+/**
+ * @brief Function for adding duration to histogram.
+ *        Bucket is found from position of highest bit, so no division or search is done on hot path.
+ * 
+ * @param histogram histogram
+ * @param cycles duration in cpu cycles
+ */
+void metrics_observe(metrics_histogram_t *histogram, uint32_t cycles) {
+    uint32_t bits = cycles > 1 ? 32 - __builtin_clz(cycles - 1) : 0; // bits of smallest power of two not below cycles
+    uint32_t bucket = bits <= 10 ? 0 : (bits - 9) / 2;
+    if (bucket >= METRICS_BUCKETS) {
+        bucket = METRICS_BUCKETS - 1;
+    }
+
+    portENTER_CRITICAL(&metrics_lock);
+    histogram->buckets[bucket]++;
+    histogram->sum += cycles;
+    histogram->count++;
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+/**
+ * @brief Function for reading consistent copy of histogram.
+ * 
+ * @param histogram histogram
+ * 
+ * @return metrics_histogram_t copy of histogram
+ */
+metrics_histogram_t metrics_read(const metrics_histogram_t *histogram) {
+    metrics_histogram_t copy;
+
+    portENTER_CRITICAL(&metrics_lock);
+    copy = *histogram;
+    portEXIT_CRITICAL(&metrics_lock);
+
+    return copy;
+}
+#endif
+
+/************************ MEMORY BUDGET ************************/
+
+/**
+ * @brief Function for creating task pinned to core, in static buffers with STATIC_ALLOCATION.
+ * 
+ * @param task function of task
+ * @param name name of task
+ * @param stack_size size of stack in bytes
+ * @param stack static stack of stack_size bytes, NULL without STATIC_ALLOCATION
+ * @param buffer static control block, NULL without STATIC_ALLOCATION
+ * @param priority priority of task
+ * @param handle output handle of task
+ * @param core core where task runs
+ * 
+ * @return bool true if task was created
+ */
+bool create_task(TaskFunction_t task, const char *name, uint32_t stack_size, StackType_t *stack, StaticTask_t *buffer,
+                 UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+#if STATIC_ALLOCATION
+    *handle = xTaskCreateStaticPinnedToCore(task, name, stack_size, NULL, priority, stack, buffer, core);
+    return *handle != NULL;
+#else
+    (void)stack;
+    (void)buffer;
+    return xTaskCreatePinnedToCore(task, name, stack_size, NULL, priority, handle, core) == pdPASS;
+#endif
+}
+
+/**
+ * @brief Function for creating mutex, in static buffer with STATIC_ALLOCATION.
+ * 
+ * @param buffer static control block, NULL without STATIC_ALLOCATION
+ * 
+ * @return SemaphoreHandle_t mutex, NULL if mutex was not created
+ */
+SemaphoreHandle_t create_mutex(StaticSemaphore_t *buffer) {
+#if STATIC_ALLOCATION
+    return xSemaphoreCreateMutexStatic(buffer);
+#else
+    (void)buffer;
+    return xSemaphoreCreateMutex();
+#endif
+}
+
+/**
+ * @brief Function for creating counting semaphore, in static buffer with STATIC_ALLOCATION.
+ * 
+ * @param max maximal count
+ * @param initial initial count
+ * @param buffer static control block, NULL without STATIC_ALLOCATION
+ * 
+ * @return SemaphoreHandle_t semaphore, NULL if semaphore was not created
+ */
+SemaphoreHandle_t create_counting_semaphore(UBaseType_t max, UBaseType_t initial, StaticSemaphore_t *buffer) {
+#if STATIC_ALLOCATION
+    return xSemaphoreCreateCountingStatic(max, initial, buffer);
+#else
+    (void)buffer;
+    return xSemaphoreCreateCounting(max, initial);
+#endif
+}
+
+/**
+ * @brief Function for creating queue, in static buffers with STATIC_ALLOCATION.
+ * 
+ * @param length capacity of queue
+ * @param item_size size of item
+ * @param storage static storage of length items, NULL without STATIC_ALLOCATION
+ * @param buffer static control block, NULL without STATIC_ALLOCATION
+ * 
+ * @return QueueHandle_t queue, NULL if queue was not created
+ */
+QueueHandle_t create_queue(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buffer) {
+#if STATIC_ALLOCATION
+    return xQueueCreateStatic(length, item_size, storage, buffer);
+#else
+    (void)storage;
+    (void)buffer;
+    return xQueueCreate(length, item_size);
+#endif
+}
+
+/**
+ * @brief Function for printing memory budget of application and state of heap at boot.
+ *        Stacks and control blocks are on heap without STATIC_ALLOCATION, telemetry stack is reserved even when uplink is disabled.
+ */
+void print_memory_budget() {
+    struct {
+        const char *name; // name of buffer
+        size_t size; // size of buffer
+    } buffers[] = {
+        {"adc banks", sizeof(adc_banks)},
+        {"calibrated tables", sizeof(calibrated_luts)},
+        {"sample queue", sizeof(sample_queue)},
+        {"history", sizeof(history)},
+        {"log index", sizeof(log_index)},
+        {"rollup tiers", sizeof(rollup_tiers) + sizeof(rollup_buckets)},
+        {"statistics", sizeof(stats)},
+        {"statistics (rtc)", sizeof(stats_rtc)},
+        {"alert rules (rtc)", sizeof(alert_rules) + sizeof(alert_states) + sizeof(alert_notified) + sizeof(alert_notified_us)},
+        {"alert events (rtc)", sizeof(alert_events)},
+        {"alert uplink", ALERT_PAYLOAD_SIZE},
+        {"log staging (rtc)", sizeof(log_batch)},
+        {"log block", LOG_BLOCK_MAX_SIZE},
+        {"uplink batch", UPLINK_BATCH_RECORDS * sizeof(log_record_t) + UPLINK_PAYLOAD_SIZE},
+        {"sampler stack", SAMPLER_STACK_SIZE},
+        {"storage stack", STORAGE_STACK_SIZE},
+        {"telemetry stack", TELEMETRY_STACK_SIZE},
+        {"httpd worker stacks", HTTPD_WORKER_COUNT * HTTPD_WORKER_STACK_SIZE},
+#if STATIC_ALLOCATION
+        {"control blocks", sizeof(sampler_task_buffer) + sizeof(storage_task_buffer) + sizeof(telemetry_task_buffer) + sizeof(httpd_worker_buffers) +
+                           sizeof(httpd_worker_queue_storage) + sizeof(httpd_worker_queue_buffer) + sizeof(httpd_workers_ready_buffer) + sizeof(log_mutex_buffer)},
+#endif
+    };
+    size_t total = 0;
+
+    printf("Memory budget (%s allocation):\n", STATIC_ALLOCATION ? "static" : "heap");
+    for (uint8_t i = 0; i < sizeof(buffers) / sizeof(buffers[0]); i++) {
+        printf("  %-20s %7lu B\n", buffers[i].name, (unsigned long)buffers[i].size);
+        total += buffers[i].size;
+    }
+    printf("  %-20s %7lu B\n", "total", (unsigned long)total);
+    printf("  %-20s %7lu B\n", "httpd stack (heap)", (unsigned long)HTTPD_STACK_SIZE);
+
+    printf("Heap: free %lu B, largest free block %lu B, lowest free %lu B\n", (unsigned long)esp_get_free_heap_size(),
+           (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), (unsigned long)esp_get_minimum_free_heap_size());
+}
+
 /************************ ADC ************************/
 
+/**
+ * @brief DMA callback called from ISR for every finished conversion frame, accumulates frame into active bank.
+ * 
+ * @param handle adc driver
+ * @param edata frame
+ * @param user_data unused
+ * 
+ * @return bool false, no task is woken
+ */
+static bool IRAM_ATTR adc_conversion_done_callback(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data) {
+    uint32_t sum[CHANNEL_COUNT] = {0};
+    uint32_t count[CHANNEL_COUNT] = {0};
+
+    // frame contains conversions of all scanned channels
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= edata->size; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *result = (const adc_digi_output_data_t *)&edata->conv_frame_buffer[i];
+        if (result->type1.channel < CHANNEL_COUNT_MAX && adc_channel_index[result->type1.channel] >= 0) {
+            uint8_t channel = adc_channel_index[result->type1.channel];
+            sum[channel] += result->type1.data;
+            ++count[channel];
+        }
+    }
+
+    portENTER_CRITICAL_ISR(&adc_bank_lock);
+    adc_bank_t *bank = &adc_banks[adc_active_bank];
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (count[channel] == 0) {
+            continue;
+        }
+        bank->sum[channel] += sum[channel];
+        bank->count[channel] += count[channel];
+        bank->frame_means[channel][bank->frames[channel] % ADC_MEDIAN_FRAMES] = (uint16_t)((sum[channel] << ADC_FRACTION_BITS) / count[channel]);
+        ++bank->frames[channel];
+    }
+    portEXIT_CRITICAL_ISR(&adc_bank_lock);
+
+    return false;
+}
+
+/**
+ * @brief Function for configuration of scan pattern and rate of continuous conversions.
+ */
+void configure_adc_pattern() {
+    adc_digi_pattern_config_t patterns[CHANNEL_COUNT];
+
+    memset(adc_channel_index, -1, sizeof(adc_channel_index));
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        patterns[channel] = (adc_digi_pattern_config_t) {
+            .atten = channels[channel].atten,
+            .channel = channels[channel].adc_channel,
+            .unit = ADC_UNIT_1,
+            .bit_width = ADC_BITWIDTH_12,
+        };
+        adc_channel_index[channels[channel].adc_channel] = channel;
+    }
+
+    adc_continuous_config_t config = {
+        .pattern_num = CHANNEL_COUNT,
+        .adc_pattern = patterns,
+        .sample_freq_hz = adc_sample_rate_hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    err = adc_continuous_config(adc_handle, &config);
+    if (err != ESP_OK) {
+        printf("Error - adc_continuous_config(): %s\n", esp_err_to_name(err));
+    }
+}
+
 /**
  * @brief Function for configuartion of ADC.
+ *        ADC runs in continuous mode, every channel of channel table is converted in one scan pattern,
+ *        conversions are transferred by DMA and accumulated in DMA callback.
  */
 void configure_adc() {
-    adc1_config_width(ADC_WIDTH_BIT_12);
-    adc1_config_channel_atten(GPIO_39, ADC_ATTEN_DB_11);
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = ADC_POOL_SIZE,
+        .conv_frame_size = ADC_FRAME_SIZE,
+        .flags.flush_pool = 1, // results are consumed in callback, pool is not read
+    };
+    err = adc_continuous_new_handle(&handle_config, &adc_handle);
+    if (err != ESP_OK) {
+        printf("Error - adc_continuous_new_handle(): %s\n", esp_err_to_name(err));
+        return;
+    }
+
+    configure_adc_pattern();
+
+    adc_continuous_evt_cbs_t callbacks = {
+        .on_conv_done = adc_conversion_done_callback,
+    };
+    err = adc_continuous_register_event_callbacks(adc_handle, &callbacks, NULL);
+    if (err != ESP_OK) {
+        printf("Error - adc_continuous_register_event_callbacks(): %s\n", esp_err_to_name(err));
+    }
+
+    err = adc_continuous_start(adc_handle);
+    if (err != ESP_OK) {
+        printf("Error - adc_continuous_start(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Function for changing rate of continuous conversions, driver is stopped while it is configured.
+ *        Conversions already accumulated in bank are kept, so next sample mixes both rates.
+ * 
+ * @param rate_hz rate of conversions
+ */
+void set_adc_sample_rate(uint32_t rate_hz) {
+    adc_sample_rate_hz = rate_hz;
+    if (adc_handle == NULL) { // ADC is configured with new rate when it starts
+        return;
+    }
+
+    err = adc_continuous_stop(adc_handle);
+    if (err != ESP_OK) {
+        printf("Error - adc_continuous_stop(): %s\n", esp_err_to_name(err));
+        return;
+    }
+
+    configure_adc_pattern();
+
+    err = adc_continuous_start(adc_handle);
+    if (err != ESP_OK) {
+        printf("Error - adc_continuous_start(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Function for loading eFuse characterization of ADC, called once at startup before conversions.
+ *        Calibrated raw to mV curve of every used attenuation is combined with temperature_lut
+ *        into table indexed by raw code, so conversion stays one lookup per sample.
+ */
+void calibrate_adc() {
+    adc_cali_line_fitting_efuse_val_t efuse = ADC_CALI_LINE_FITTING_EFUSE_VAL_DEFAULT_VREF;
+    uint8_t tables = 0;
+
+    err = adc_cali_scheme_line_fitting_check_efuse(&efuse);
+    if (err != ESP_OK) {
+        printf("Error - adc_cali_scheme_line_fitting_check_efuse(): %s\n", esp_err_to_name(err));
+    }
+    printf("ADC calibration: %s\n", efuse == ADC_CALI_LINE_FITTING_EFUSE_VAL_EFUSE_TP ? "eFuse two point" :
+                                    efuse == ADC_CALI_LINE_FITTING_EFUSE_VAL_EFUSE_VREF ? "eFuse Vref" : "default Vref");
+
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        adc_atten_t atten = channels[channel].atten;
+
+        if (adc_cali_handles[atten] != NULL) { // attenuation shared with previous channel
+            continue;
+        }
+
+        adc_cali_line_fitting_config_t config = {
+            .unit_id = ADC_UNIT_1,
+            .atten = atten,
+            .bitwidth = ADC_BITWIDTH_12,
+            .default_vref = ADC_DEFAULT_VREF_MV,
+        };
+        err = adc_cali_create_scheme_line_fitting(&config, &adc_cali_handles[atten]);
+        if (err != ESP_OK) {
+            printf("Error - adc_cali_create_scheme_line_fitting(): %s\n", esp_err_to_name(err));
+            continue;
+        }
+
+        if (tables >= ADC_CALI_TABLES) {
+            printf("Error - calibrate_adc(): no table left for attenuation %d\n", atten);
+            continue;
+        }
+
+        int16_t *lut = calibrated_luts[tables];
+        for (int raw = 0; raw < LUT_SIZE; raw++) {
+            int mV = raw;
+            adc_cali_raw_to_voltage(adc_cali_handles[atten], raw, &mV);
+            lut[raw] = temperature_lut[mV < 0 ? 0 : mV >= LUT_SIZE ? LUT_SIZE - 1 : mV];
+        }
+        calibrated_lut_index[atten] = tables++;
+    }
+}
+
+/**
+ * @brief Function for getting one decimated ADC value of every channel from conversions accumulated since last call.
+ * 
+ * @param raw output array of CHANNEL_COUNT raw values with ADC_FRACTION_BITS
+ * 
+ * @return uint32_t mask of channels with conversions finished since last call
+ */
+uint32_t read_adc(uint32_t *raw) {
+    uint16_t means[ADC_MEDIAN_FRAMES];
+    uint32_t mask = 0;
+
+    // swap banks, DMA callback continues with cleared bank
+    portENTER_CRITICAL(&adc_bank_lock);
+    adc_bank_t *bank = &adc_banks[adc_active_bank];
+    adc_active_bank ^= 1;
+    memset(&adc_banks[adc_active_bank], 0, sizeof(adc_bank_t));
+    portEXIT_CRITICAL(&adc_bank_lock);
+
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (bank->count[channel] == 0) {
+            continue;
+        }
+
+        if (adc_filter == ADC_FILTER_MEDIAN) {
+            uint16_t count = bank->frames[channel] < ADC_MEDIAN_FRAMES ? bank->frames[channel] : ADC_MEDIAN_FRAMES;
+
+            // insertion sort of frame means
+            for (uint16_t i = 0; i < count; i++) {
+                uint16_t value = bank->frame_means[channel][i];
+                int j = i - 1;
+                while (j >= 0 && means[j] > value) {
+                    means[j + 1] = means[j];
+                    --j;
+                }
+                means[j + 1] = value;
+            }
+
+            raw[channel] = count % 2 ? means[count / 2] : (means[count / 2 - 1] + means[count / 2]) / 2;
+        } else {
+            raw[channel] = (uint32_t)((bank->sum[channel] << ADC_FRACTION_BITS) / bank->count[channel]);
+        }
+        mask |= 1UL << channel;
+    }
+
+    return mask;
 }
 
 /************************ LED ************************/
@@ -80,502 +1084,4777 @@ void configure_led() {
         .mode = GPIO_MODE_OUTPUT,
     };
     gpio_config(&config);
-    gpio_set_level(GPIO_LED, 0);
+    gpio_set_level(GPIO_LED, threshold_overcome);
+    gpio_hold_dis(GPIO_LED); // led could be held during deep sleep
 }
 
 /************************ TEMPERATURE AND THRESHOLD ************************/
 
 /**
- * @brief Function for getting temperature.
+ * @brief Function for copying channel table and hysteresis of threshold, consistent with settings written on other core.
+ * 
+ * @param copy output channel table with CHANNEL_COUNT entries
+ * @param hysteresis output hysteresis of threshold, NULL if it is not needed
  */
-void get_temperature() {
-    int mV = adc1_get_raw(GPIO_39);
+void read_channels(channel_t *copy, double *hysteresis) {
+    portENTER_CRITICAL(&channel_lock);
+    memcpy(copy, channels, sizeof(channels));
+    if (hysteresis != NULL) {
+        *hysteresis = threshold_hysteresis;
+    }
+    portEXIT_CRITICAL(&channel_lock);
+}
 
-    temperature = (8.194 - sqrt(pow(-8.194, 2) + 4 * 0.00262 * (1324 - mV))) / (2 * -0.00262) + 40;
+/**
+ * @brief Function for getting lookup table of channel indexed by raw code.
+ *        Without calibration raw code is used as millivolts.
+ * 
+ * @param channel index of channel
+ * 
+ * @return const int16_t* lookup table with LUT_SIZE entries
+ */
+const int16_t *channel_lut(uint8_t channel) {
+    int8_t table = calibrated_lut_index[channels[channel].atten];
 
-    printf("Temperature: %.2f °C\n", temperature);
+    return table >= 0 ? calibrated_luts[table] : temperature_lut;
 }
 
 /**
- * @brief Function for handling threshold.
+ * @brief Function for converting raw ADC value of channel to temperature.
+ * 
+ * @param channel index of channel
+ * @param raw raw value with ADC_FRACTION_BITS
+ * 
+ * @return double temperature
  */
-void handle_threshold() {
-    if (threshold != THRESHOLD_DEFAULT_VALUE) {
-        // temperature is higher than threshold or 
-        // if threshold was set still make led on if temperature is higher than threshold - 1.0
-        if (temperature >= threshold || (threshold_overcome && temperature >= threshold - 1.0)) {
-            threshold_overcome = true;
-            gpio_set_level(GPIO_LED, 1); 
-        } else {
-            threshold_overcome = false;
-            gpio_set_level(GPIO_LED, 0);
+double convert_temperature(uint8_t channel, uint32_t raw) {
+    if (conversion_mode == CONVERSION_EXACT) {
+        uint32_t index = raw >> ADC_FRACTION_BITS;
+        double mV = raw / (double)(1 << ADC_FRACTION_BITS);
+        adc_cali_handle_t handle = adc_cali_handles[channels[channel].atten];
+        int low = index;
+        int high = index < LUT_SIZE - 1 ? index + 1 : index; // last code has no neighbour above
+
+        // calibrated millivolts of neighbouring raw codes are interpolated
+        if (handle != NULL && adc_cali_raw_to_voltage(handle, low, &low) == ESP_OK && adc_cali_raw_to_voltage(handle, high, &high) == ESP_OK) {
+            mV = low + (high - low) * (mV - index);
         }
+        return TEMPERATURE_FROM_MV(mV);
     }
+
+    return lut_convert(channel_lut(channel), raw, conversion_mode == CONVERSION_LUT_INTERPOLATED);
 }
 
-/************************ WIFI STATION ************************/
+/**
+ * @brief Function for getting temperature of every channel.
+ *        Calibration of channel is applied to converted temperature.
+ */
+void get_temperature() {
+    uint32_t raw[CHANNEL_COUNT];
+    channel_t config[CHANNEL_COUNT];
+    uint32_t mask = read_adc(raw);
+
+    read_channels(config, NULL);
+
+    if (mask == 0) {
+        printf("Error - read_adc(): no conversions\n");
+    }
+
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (!(mask & (1UL << channel))) {
+            temperature[channel] = NAN;
+            continue;
+        }
+
+        temperature[channel] = config[channel].gain * convert_temperature(channel, raw[channel]) + config[channel].offset;
+        printf("Temperature %u: %.2f °C\n", channel, temperature[channel]);
+    }
+}
 
 /**
- * @brief Function for configuration of wifi station. 
- *        Inspired by: https://medium.com/@fatehsali517/how-to-connect-esp32-to-wifi-using-esp-idf-iot-development-framework-d798dc89f0d6
+ * @brief Function for finding raw value of channel where temperature reaches given value.
+ *        Temperature falls with rising raw value, so all raw values up to result have at least given temperature.
+ * 
+ * @param channel index of channel
+ * @param value temperature before calibration of channel
+ * 
+ * @return uint32_t highest raw value with temperature not lower than value
  */
-void wifi_configuration_station()
-{
-    err = esp_netif_init();
-    if (err != ESP_OK) {
-        printf("Error - esp_netif_init(): %s\n", esp_err_to_name(err));
+uint32_t temperature_to_raw(uint8_t channel, double value) {
+    return lut_find_raw(channel_lut(channel), value);
+}
+
+/**
+ * @brief Function for updating led from threshold states of all channels.
+ *        Led is on while threshold of any channel is overcome, it is switched only when its state changes.
+ */
+void update_threshold_led() {
+    bool overcome = false;
+
+    portENTER_CRITICAL(&channel_lock);
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        overcome |= channels[channel].threshold_overcome;
     }
+    portEXIT_CRITICAL(&channel_lock);
 
-    err = esp_event_loop_create_default();
-    if (err != ESP_OK) {
-        printf("Error - esp_event_loop_create_default(): %s\n", esp_err_to_name(err));
+    if (overcome != threshold_overcome) {
+        threshold_overcome = overcome;
+        gpio_set_level(GPIO_LED, overcome);
     }
+}
 
-    esp_netif_create_default_wifi_sta();
+/**
+ * @brief Function for handling threshold of every channel.
+ *        Threshold is compared with last temperature or with its moving average, see threshold_input.
+ *        State is evaluated under channel_lock, so reset of state by changed threshold is not overwritten.
+ */
+void handle_threshold() {
+    double value[CHANNEL_COUNT];
+    uint32_t changed = 0; // mask of channels with changed state
+    uint32_t overcome_mask = 0; // mask of channels with overcome threshold
 
-    wifi_init_config_t wifi_initiation = WIFI_INIT_CONFIG_DEFAULT();
-    err = esp_wifi_init(&wifi_initiation);  
-    if (err != ESP_OK) {
-        printf("Error - esp_wifi_init(): %s\n", esp_err_to_name(err));
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        value[channel] = temperature[channel];
+        if (threshold_input == THRESHOLD_INPUT_EWMA && !isnan(stats_rtc[channel].ewma)) {
+            value[channel] = stats_rtc[channel].ewma;
+        }
     }
 
-    wifi_config_t wifi_configuration = {
-        .sta = {
-            .ssid = "TP-LINK_8DBC",
-            .password = "38599279",
-           }
-        };
-    
-    err = esp_wifi_set_mode(WIFI_MODE_STA);
-    if (err != ESP_OK) {
-        printf("Error - esp_wifi_set_mode(): %s\n", esp_err_to_name(err));
+    portENTER_CRITICAL(&channel_lock);
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        channel_t *config = &channels[channel];
+
+        if (config->threshold == THRESHOLD_DEFAULT_VALUE || isnan(value[channel])) {
+            continue;
+        }
+
+        bool overcome = threshold_evaluate(value[channel], config->threshold, threshold_hysteresis, config->threshold_overcome);
+        if (overcome != config->threshold_overcome) {
+            config->threshold_overcome = overcome;
+            changed |= 1UL << channel;
+        }
+        overcome_mask |= (uint32_t)overcome << channel;
     }
+    portEXIT_CRITICAL(&channel_lock);
+
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (changed & (1UL << channel)) {
+            printf("Threshold of channel %u %s\n", channel, overcome_mask & (1UL << channel) ? "overcome" : "released");
+        }
+    }
+
+    update_threshold_led();
+}
+
+/************************ WIFI ************************/
+
+/**
+ * @brief Function for connecting station.
+ * 
+ * @param arg unused
+ */
+void wifi_connect(void *arg) {
+    err = esp_wifi_connect();
+    if (err != ESP_OK) {
+        printf("Error - esp_wifi_connect(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Function for handling wifi events, station is connected after start and reconnected after every disconnection.
+ * 
+ * @param arg unused
+ * @param event_base event base
+ * @param event_id event
+ * @param event_data unused
+ */
+void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
+    if (event_base != WIFI_EVENT) {
+        return;
+    }
+
+    if (event_id == WIFI_EVENT_STA_START) {
+        wifi_connect(NULL);
+    } else if (event_id == WIFI_EVENT_STA_DISCONNECTED && wifi_reconnect_timer != NULL && !esp_timer_is_active(wifi_reconnect_timer)) {
+        esp_timer_start_once(wifi_reconnect_timer, (uint64_t)WIFI_RECONNECT_DELAY_MS * 1000);
+    }
+}
+
+/**
+ * @brief Function for configuration of wifi, station and access point run together in one driver.
+ *        Station keeps upstream link for time synchronization and telemetry while access point serves local clients.
+ *        Access point follows channel of station.
+ *        Inspired by: https://medium.com/@fatehsali517/how-to-connect-esp32-to-wifi-using-esp-idf-iot-development-framework-d798dc89f0d6
+ *        and https://esp32tutorials.com/esp32-web-server-esp-idf/
+ */
+void wifi_configuration() {
+    err = esp_netif_init();
+    if (err != ESP_OK) {
+        printf("Error - esp_netif_init(): %s\n", esp_err_to_name(err));
+    }
+
+    err = esp_event_loop_create_default();
+    if (err != ESP_OK) {
+        printf("Error - esp_event_loop_create_default(): %s\n", esp_err_to_name(err));
+    }
+
+    esp_netif_create_default_wifi_sta();
+    esp_netif_create_default_wifi_ap();
+
+    wifi_init_config_t wifi_initiation = WIFI_INIT_CONFIG_DEFAULT();
+    err = esp_wifi_init(&wifi_initiation);
+    if (err != ESP_OK) {
+        printf("Error - esp_wifi_init(): %s\n", esp_err_to_name(err));
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = wifi_connect,
+        .name = "wifi_reconnect",
+    };
+    err = esp_timer_create(&timer_args, &wifi_reconnect_timer);
+    if (err != ESP_OK) {
+        printf("Error - esp_timer_create(): %s\n", esp_err_to_name(err));
+    }
+
+    err = esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler, NULL, NULL);
+    if (err != ESP_OK) {
+        printf("Error - esp_event_handler_instance_register(): %s\n", esp_err_to_name(err));
+    }
+
+    // credentials come from settings
+    wifi_config_t station_config = {0};
+    memcpy(station_config.sta.ssid, wifi_sta_ssid, strnlen(wifi_sta_ssid, sizeof(station_config.sta.ssid)));
+    memcpy(station_config.sta.password, wifi_sta_password, strnlen(wifi_sta_password, sizeof(station_config.sta.password)));
+
+    wifi_config_t access_point_config = {
+        .ap = {
+            .ssid = WIFI_SSID,
+            .ssid_len = strlen(WIFI_SSID),
+            .authmode = WIFI_AUTH_OPEN,
+            .max_connection = WIFI_AP_MAX_CONNECTIONS,
+        },
+    };
+
+    err = esp_wifi_set_mode(WIFI_MODE_APSTA);
+    if (err != ESP_OK) {
+        printf("Error - esp_wifi_set_mode(): %s\n", esp_err_to_name(err));
+    }
+
+    err = esp_wifi_set_config(WIFI_IF_STA, &station_config);
+    if (err != ESP_OK) {
+        printf("Error - esp_wifi_set_config(): %s\n", esp_err_to_name(err));
+    }
+
+    err = esp_wifi_set_config(WIFI_IF_AP, &access_point_config);
+    if (err != ESP_OK) {
+        printf("Error - esp_wifi_set_config(): %s\n", esp_err_to_name(err));
+    }
+
+    // station connects from WIFI_EVENT_STA_START
+    err = esp_wifi_start();
+    if (err != ESP_OK) {
+        printf("Error - esp_wifi_start(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/************************ RTC ************************/
+
+/**
+ * @brief Function for computing time of timebase at given esp_timer time, caller holds time_lock.
+ *        Slewed correction is applied at most TIME_SLEW_PPM, so time never goes back between resynchronizations.
+ * 
+ * @param mono_us esp_timer time
+ * @param applied_slew_us output for part of slewed correction already applied, may be NULL
+ * 
+ * @return int64_t wall-clock time in microseconds, RTC time if time is not synchronized yet
+ */
+int64_t timebase_at(int64_t mono_us, int64_t *applied_slew_us) {
+    int64_t elapsed_us = mono_us - timebase.base_mono_us;
+
+    if (timebase.base_wall_us == 0) {
+        if (applied_slew_us != NULL) {
+            *applied_slew_us = 0;
+        }
+        return (int64_t)timebase.base_rtc_us + elapsed_us;
+    }
+
+    int64_t slew_max_us = elapsed_us * TIME_SLEW_PPM / 1000000;
+    int64_t slew_us = timebase.slew_us;
+    if (slew_us > slew_max_us) {
+        slew_us = slew_max_us;
+    } else if (slew_us < -slew_max_us) {
+        slew_us = -slew_max_us;
+    }
+
+    if (applied_slew_us != NULL) {
+        *applied_slew_us = slew_us;
+    }
+
+    return timebase.base_wall_us + elapsed_us + elapsed_us * timebase.rate_ppb / 1000000000 + slew_us;
+}
+
+/**
+ * @brief Function for moving anchor of timebase to given esp_timer time without change of time, caller holds time_lock.
+ * 
+ * @param mono_us esp_timer time
+ */
+void timebase_anchor(int64_t mono_us) {
+    int64_t applied_slew_us;
+    int64_t time_us = timebase_at(mono_us, &applied_slew_us);
+
+    if (timebase.base_wall_us != 0) {
+        timebase.base_wall_us = time_us;
+        timebase.slew_us -= applied_slew_us;
+    }
+    timebase.base_mono_us = mono_us;
+    timebase.base_rtc_us = esp_rtc_get_time_us();
+}
+
+/**
+ * @brief Function for initialization of timebase after boot or wake from deep sleep.
+ *        esp_timer restarts from zero, so time is carried over by RTC which kept counting.
+ */
+void init_timebase() {
+    portENTER_CRITICAL(&time_lock);
+    uint64_t rtc_us = esp_rtc_get_time_us();
+    int64_t mono_us = esp_timer_get_time();
+    if (timebase.base_wall_us != 0) {
+        timebase.base_wall_us += (int64_t)(rtc_us - timebase.base_rtc_us);
+    }
+    timebase.monotonic_offset_us += timebase.base_mono_us + (int64_t)(rtc_us - timebase.base_rtc_us) - mono_us;
+    timebase.base_mono_us = mono_us;
+    timebase.base_rtc_us = rtc_us;
+    // drift is estimated only from resynchronizations measured by esp_timer of this boot
+    timebase.last_sync_mono_us = 0;
+    portEXIT_CRITICAL(&time_lock);
+}
+
+/**
+ * @brief Function for anchoring timebase before deep sleep, so time spent awake is measured by esp_timer.
+ */
+void anchor_time() {
+    portENTER_CRITICAL(&time_lock);
+    timebase_anchor(esp_timer_get_time());
+    portEXIT_CRITICAL(&time_lock);
+}
+
+/**
+ * @brief Callback of SNTP called when time is synchronized.
+ *        First synchronization and large errors step time, smaller errors are slewed
+ *        and their part not explained by previous correction updates frequency correction.
+ * 
+ * @param tv synchronized time
+ */
+void time_sync_callback(struct timeval *tv) {
+    int64_t sync_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    int64_t error_us = 0;
+    bool stepped = false;
+
+    portENTER_CRITICAL(&time_lock);
+    int64_t mono_us = esp_timer_get_time();
+    timebase_anchor(mono_us);
+    error_us = sync_us - timebase.base_wall_us;
+
+    if (timebase.base_wall_us == 0 || error_us > TIME_STEP_THRESHOLD_US || error_us < -TIME_STEP_THRESHOLD_US) {
+        timebase.base_wall_us = sync_us;
+        timebase.slew_us = 0;
+        stepped = true;
+    } else {
+        int64_t interval_us = mono_us - timebase.last_sync_mono_us;
+        if (timebase.last_sync_mono_us > 0 && interval_us > 0) {
+            int64_t drift_ppb = (error_us - timebase.slew_us) * 1000000000 / interval_us;
+            int64_t rate_ppb = timebase.rate_ppb + drift_ppb / 2;
+            if (rate_ppb > TIME_RATE_LIMIT_PPB) {
+                rate_ppb = TIME_RATE_LIMIT_PPB;
+            } else if (rate_ppb < -TIME_RATE_LIMIT_PPB) {
+                rate_ppb = -TIME_RATE_LIMIT_PPB;
+            }
+            timebase.rate_ppb = (int32_t)rate_ppb;
+        }
+        timebase.slew_us = error_us;
+    }
+    timebase.last_sync_mono_us = mono_us;
+    int32_t rate_ppb = timebase.rate_ppb;
+    portEXIT_CRITICAL(&time_lock);
+
+    if (stepped) {
+        struct tm timeinfo;
+        localtime_r(&tv->tv_sec, &timeinfo);
+        printf("Time initialized to: %s", asctime(&timeinfo));
+    } else {
+        printf("Time resynchronized, error %lld us, rate correction %ld ppb\n", (long long)error_us, (long)rate_ppb);
+    }
+}
+
+/**
+ * @brief Function for initliazation of server time using NTP protocol.
+ *        Function does not wait for synchronization, time is set in time_sync_callback().
+ *        Time is resynchronized every TIME_RESYNC_INTERVAL_MS.
+ *        Inspired by: https://stackoverflow.com/questions/56025619/how-to-resync-time-from-ntp-server-in-esp-idf
+ */
+void init_time() {
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, ntp_server);
+    sntp_set_sync_interval(TIME_RESYNC_INTERVAL_MS);
+    sntp_set_time_sync_notification_cb(time_sync_callback);
+    sntp_init();
+}
+
+/**
+ * @brief Function for getting actual time in microseconds based on esp_timer.
+ *        Before time is synchronized, result is RTC time.
+ * 
+ * @return int64_t actual time in microseconds
+ */
+int64_t get_time_us() {
+    portENTER_CRITICAL(&time_lock);
+    int64_t time_us = timebase_at(esp_timer_get_time(), NULL);
+    portEXIT_CRITICAL(&time_lock);
+
+    return time_us;
+}
+
+/**
+ * @brief Function for getting monotonic time in microseconds, esp_timer time which keeps counting over deep sleep.
+ *        Unlike actual time it is not stepped by time synchronization, so it measures durations.
+ * 
+ * @return int64_t monotonic time in microseconds
+ */
+int64_t get_monotonic_us() {
+    portENTER_CRITICAL(&time_lock);
+    int64_t mono_us = timebase.monotonic_offset_us + esp_timer_get_time();
+    portEXIT_CRITICAL(&time_lock);
+
+    return mono_us;
+}
+
+/**
+ * @brief Function for converting time taken before time synchronization to actual time.
+ *        Used for samples still in RAM, so they are back-filled once time is synchronized.
+ * 
+ * @param time_us time in microseconds
+ * 
+ * @return int64_t actual time, or unchanged time if it is already actual or time is not synchronized
+ */
+int64_t resolve_time_us(int64_t time_us) {
+    if (time_us >= TIME_VALID_EPOCH_US) {
+        return time_us;
+    }
+
+    portENTER_CRITICAL(&time_lock);
+    int64_t mono_us = esp_timer_get_time();
+    int64_t offset_us = 0;
+    if (timebase.base_wall_us != 0) {
+        offset_us = timebase_at(mono_us, NULL) - ((int64_t)timebase.base_rtc_us + mono_us - timebase.base_mono_us);
+    }
+    portEXIT_CRITICAL(&time_lock);
+
+    return time_us + offset_us;
+}
+
+/**
+ * @brief Function for converting timestamp in seconds taken before time synchronization to actual time.
+ * 
+ * @param timestamp timestamp
+ * 
+ * @return uint32_t actual time, or unchanged timestamp if it is already actual or time is not synchronized
+ */
+uint32_t resolve_timestamp(uint32_t timestamp) {
+    if (timestamp < TIME_VALID_EPOCH) {
+        return (uint32_t)(resolve_time_us((int64_t)timestamp * 1000000) / 1000000);
+    }
+
+    return timestamp;
+}
+
+/**
+ * @brief Function for formatting time as string in ours time zone.
+ * 
+ * @param time time
+ * @param buffer output buffer
+ * @param size size of output buffer
+ */
+void format_time(time_t time, char *buffer, size_t size) {
+    struct tm timeinfo;
+    time_t local_time = time + TIMEZONE_OFFSET_S;
+    localtime_r(&local_time, &timeinfo);
+
+    snprintf(buffer, size,
+             "%04d-%02d-%02d %02d:%02d:%02d ",
+             timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+             timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+}
+
+/************************ SAMPLE QUEUE ************************/
+
+/**
+ * @brief Function for pushing sample to queue, called only by sampler task.
+ * 
+ * @param sample sample
+ * 
+ * @return bool false if queue is full
+ */
+bool sample_queue_push(const sample_t *sample) {
+    unsigned head = atomic_load_explicit(&sample_queue_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&sample_queue_tail, memory_order_acquire);
+
+    if (head - tail >= SAMPLE_QUEUE_SIZE) {
+        return false;
+    }
+
+    sample_queue[head % SAMPLE_QUEUE_SIZE] = *sample;
+    atomic_store_explicit(&sample_queue_head, head + 1, memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief Function for popping sample from queue, called only by storage task.
+ * 
+ * @param sample output sample
+ * 
+ * @return bool false if queue is empty
+ */
+bool sample_queue_pop(sample_t *sample) {
+    unsigned tail = atomic_load_explicit(&sample_queue_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&sample_queue_head, memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+
+    *sample = sample_queue[tail % SAMPLE_QUEUE_SIZE];
+    atomic_store_explicit(&sample_queue_tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+/************************ LIVE STATE ************************/
+
+/**
+ * @brief Function for building sample from actual temperatures.
+ * 
+ * @param sample output sample
+ */
+void build_sample(sample_t *sample) {
+    sample->time_us = get_time_us();
+
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        sample->temperature[channel] = isnan(temperature[channel]) ? TEMPERATURE_INVALID : (int16_t)lround(temperature[channel] * 100.0);
+    }
+}
+
+/**
+ * @brief Function for publishing new sample to live state, called only by sampler task.
+ *        Readers never block, they retry when sample was published during their copy.
+ * 
+ * @param sample sample
+ */
+void publish_sample(const sample_t *sample) {
+    unsigned sequence = atomic_load_explicit(&live_sequence, memory_order_relaxed);
+    atomic_store_explicit(&live_sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    live_sample = *sample;
+    history[history_head] = *sample;
+    history_head = (history_head + 1) % HISTORY_SIZE;
+    if (history_count < HISTORY_SIZE) {
+        ++history_count;
+    }
+
+    atomic_store_explicit(&live_sequence, sequence + 2, memory_order_release);
+}
+
+/**
+ * @brief Function for getting snapshot of last sample.
+ * 
+ * @return sample_t last sample
+ */
+sample_t read_live_sample() {
+    sample_t sample;
+    unsigned sequence;
+
+    do {
+        sequence = atomic_load_explicit(&live_sequence, memory_order_acquire);
+        sample = live_sample;
+        atomic_thread_fence(memory_order_acquire);
+    } while ((sequence & 1) || sequence != atomic_load_explicit(&live_sequence, memory_order_relaxed));
+
+    return sample;
+}
+
+/**
+ * @brief Function for getting snapshot of history, newest sample first.
+ * 
+ * @param samples output array of HISTORY_SIZE samples
+ * @param published output count of samples published since boot, may be NULL
+ * 
+ * @return uint16_t count of copied samples
+ */
+uint16_t history_copy(sample_t *samples, uint32_t *published) {
+    uint16_t count;
+    unsigned sequence;
+
+    do {
+        sequence = atomic_load_explicit(&live_sequence, memory_order_acquire);
+        count = history_count;
+        for (uint16_t i = 0; i < count; i++) {
+            samples[i] = history[(history_head + HISTORY_SIZE - 1 - i) % HISTORY_SIZE];
+        }
+        atomic_thread_fence(memory_order_acquire);
+    } while ((sequence & 1) || sequence != atomic_load_explicit(&live_sequence, memory_order_relaxed));
+
+    if (published != NULL) {
+        *published = sequence / 2;
+    }
+
+    return count;
+}
+
+/************************ STATISTICS ************************/
+
+/**
+ * @brief Function for initialization of statistics kept in RTC memory, called when RTC memory was cleared by reset.
+ */
+void init_stats() {
+    memset(stats_rtc, 0, sizeof(stats_rtc));
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        stats_rtc[channel].ewma = NAN;
+    }
+}
+
+/**
+ * @brief Function for getting window of channel from RTC memory or DRAM.
+ * 
+ * @param channel index of channel
+ * @param window index of window
+ * 
+ * @return stats_window_t* window
+ */
+stats_window_t *stats_window(uint8_t channel, uint8_t window) {
+    return window < STATS_RTC_WINDOWS ? &stats_rtc[channel].windows[window] : &stats[channel].windows[window - STATS_RTC_WINDOWS];
+}
+
+/**
+ * @brief Function for moving window to given bucket, buckets which left window are cleared.
+ *        Caller holds stats_lock.
+ * 
+ * @param window window
+ * @param number number of newest bucket
+ */
+void stats_advance(stats_window_t *window, uint32_t number) {
+    uint32_t expired = number - window->current;
+
+    if (expired > STATS_BUCKETS) {
+        expired = STATS_BUCKETS;
+    }
+
+    for (uint32_t i = 1; i <= expired; i++) {
+        memset(&window->buckets[(window->current + i) % STATS_BUCKETS], 0, sizeof(stats_bucket_t));
+    }
+    window->current = number;
+}
+
+/**
+ * @brief Function for adding actual temperatures to statistics, called after get_temperature() by sampler task and low power cycle.
+ *        Every sample updates only newest bucket of every window.
+ */
+void update_stats() {
+    uint32_t now_s = get_monotonic_us() / 1000000;
+
+    portENTER_CRITICAL(&stats_lock);
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        channel_stats_rtc_t *channel_stats = &stats_rtc[channel];
+
+        if (isnan(temperature[channel])) {
+            continue;
+        }
+
+        int16_t value = (int16_t)lround(temperature[channel] * 100.0);
+        channel_stats->ewma = isnan(channel_stats->ewma) ? temperature[channel] :
+                              channel_stats->ewma + STATS_EWMA_ALPHA * (temperature[channel] - channel_stats->ewma);
+
+        for (uint8_t i = 0; i < STATS_WINDOWS; i++) {
+            stats_window_t *window = stats_window(channel, i);
+            stats_advance(window, now_s / (stats_window_s[i] / STATS_BUCKETS));
+
+            stats_bucket_t *bucket = &window->buckets[window->current % STATS_BUCKETS];
+            if (bucket->count == 0 || value < bucket->min) {
+                bucket->min = value;
+            }
+            if (bucket->count == 0 || value > bucket->max) {
+                bucket->max = value;
+            }
+            bucket->sum += value;
+            bucket->sum_squares += (int32_t)value * value;
+            ++bucket->count;
+        }
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+/**
+ * @brief Function for getting statistics of channel in window ending now.
+ *        Buckets are joined only when statistics are requested.
+ * 
+ * @param channel index of channel
+ * @param window index of window
+ * @param summary output statistics
+ * 
+ * @return double exponentially weighted moving average of channel
+ */
+double get_stats(uint8_t channel, uint8_t window, stats_summary_t *summary) {
+    int64_t sum = 0;
+    int64_t sum_squares = 0;
+
+    memset(summary, 0, sizeof(stats_summary_t));
+
+    uint32_t now = (get_monotonic_us() / 1000000) / (stats_window_s[window] / STATS_BUCKETS);
+    portENTER_CRITICAL(&stats_lock);
+    const stats_window_t *ring = stats_window(channel, window);
+    double ewma = stats_rtc[channel].ewma;
+    for (uint32_t i = 0; i < STATS_BUCKETS; i++) {
+        const stats_bucket_t *bucket = &ring->buckets[(ring->current - i) % STATS_BUCKETS];
+
+        // buckets are not moved when no samples come, old buckets are skipped here
+        if (ring->current < i || now - (ring->current - i) >= STATS_BUCKETS || bucket->count == 0) {
+            continue;
+        }
+
+        if (summary->count == 0 || bucket->min < summary->min) {
+            summary->min = bucket->min;
+        }
+        if (summary->count == 0 || bucket->max > summary->max) {
+            summary->max = bucket->max;
+        }
+        sum += bucket->sum;
+        sum_squares += bucket->sum_squares;
+        summary->count += bucket->count;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (summary->count > 0) {
+        double mean = (double)sum / summary->count;
+        summary->mean = mean / 100.0;
+        summary->variance = ((double)sum_squares / summary->count - mean * mean) / 10000.0;
+        if (summary->variance < 0) { // rounding error of constant temperature
+            summary->variance = 0;
+        }
+    }
+
+    return ewma;
+}
+
+/************************ ALERTS ************************/
+
+/**
+ * @brief Function for checking if alert rule is valid.
+ * 
+ * @param rule rule
+ * 
+ * @return bool true if type, channel and limits are valid
+ */
+bool alert_rule_valid(const alert_rule_t *rule) {
+    if (rule->type == ALERT_OFF) {
+        return true;
+    }
+
+    return rule->type <= ALERT_STALE && rule->channel < CHANNEL_COUNT && isfinite(rule->limit) &&
+           isfinite(rule->hysteresis) && rule->hysteresis >= 0.0 && (rule->type != ALERT_STALE || rule->limit > 0.0);
+}
+
+/**
+ * @brief Function for copying rule table.
+ * 
+ * @param rules output rules
+ */
+void alert_rules_capture(alert_rule_t *rules) {
+    portENTER_CRITICAL(&alert_lock);
+    memcpy(rules, alert_rules, sizeof(alert_rules));
+    portEXIT_CRITICAL(&alert_lock);
+}
+
+/**
+ * @brief Function for replacing rule table, state of every changed rule starts again.
+ *        Alert of changed rule which was notified as raised is notified as released unless it is raised again.
+ * 
+ * @param rules rules
+ */
+void alert_rules_apply(const alert_rule_t *rules) {
+    portENTER_CRITICAL(&alert_lock);
+    for (uint8_t i = 0; i < ALERT_RULES_MAX; i++) {
+        if (memcmp(&alert_rules[i], &rules[i], sizeof(alert_rule_t)) != 0) {
+            alert_rules[i] = rules[i];
+            memset(&alert_states[i], 0, sizeof(alert_state_t));
+        }
+    }
+    portEXIT_CRITICAL(&alert_lock);
+}
+
+/**
+ * @brief Function for evaluating all alert rules with last temperatures, called after every sample.
+ *        Notification carries latest state of rule and is queued at most once per ALERT_NOTIFY_INTERVAL_US of rule.
+ *        Durations are measured in monotonic time, so time synchronization does not raise pending alerts at once,
+ *        actual time is only used as timestamp of notification.
+ * 
+ * @param time_us actual time of sample
+ * 
+ * @return bool true if notification was queued
+ */
+bool handle_alerts(int64_t time_us) {
+    alert_event_t events[ALERT_RULES_MAX];
+    uint8_t count = 0;
+    uint32_t timestamp = resolve_time_us(time_us) / 1000000;
+    int64_t mono_us = get_monotonic_us();
+
+    portENTER_CRITICAL(&alert_lock);
+    for (uint8_t i = 0; i < ALERT_RULES_MAX; i++) {
+        const alert_rule_t *rule = &alert_rules[i];
+        alert_state_t *state = &alert_states[i];
+
+        if (rule->type != ALERT_OFF) {
+            alert_evaluate(rule, state, temperature[rule->channel], mono_us);
+        }
+
+        if (state->active == alert_notified[i] || (alert_notified_us[i] != 0 && mono_us - alert_notified_us[i] < ALERT_NOTIFY_INTERVAL_US)) {
+            continue;
+        }
+        alert_notified[i] = state->active;
+        alert_notified_us[i] = mono_us;
+
+        double value = rule->type == ALERT_RATE ? state->rate : temperature[rule->channel];
+        alert_event_t *event = &alert_events[alert_event_count % ALERT_EVENTS_SIZE];
+        event->sequence = alert_event_count++;
+        event->timestamp = timestamp;
+        event->value = !isfinite(value) || fabs(value) >= INT16_MAX / 100.0 ? TEMPERATURE_INVALID : (int16_t)lround(value * 100.0);
+        event->rule = i;
+        event->type = rule->type;
+        event->channel = rule->channel;
+        event->active = state->active;
+        events[count++] = *event;
+    }
+    portEXIT_CRITICAL(&alert_lock);
+
+    for (uint8_t i = 0; i < count; i++) {
+        printf("Alert %u (%s) of channel %u %s\n", events[i].rule, alert_type_names[events[i].type], events[i].channel, events[i].active ? "raised" : "released");
+    }
+
+    return count > 0;
+}
+
+/**
+ * @brief Function for reading notification from ring.
+ * 
+ * @param sequence sequence number of notification, moved to oldest notification still in ring
+ * @param event output notification
+ * 
+ * @return bool false if there is no notification with this or later sequence number
+ */
+bool read_alert_event(uint32_t *sequence, alert_event_t *event) {
+    bool found = false;
+
+    portENTER_CRITICAL(&alert_lock);
+    if (alert_event_count - *sequence > ALERT_EVENTS_SIZE) { // overwritten by newer notifications
+        *sequence = alert_event_count - ALERT_EVENTS_SIZE;
+    }
+    if (*sequence != alert_event_count) {
+        *event = alert_events[*sequence % ALERT_EVENTS_SIZE];
+        found = true;
+    }
+    portEXIT_CRITICAL(&alert_lock);
+
+    return found;
+}
+
+/**
+ * @brief Function for formatting notification as json object.
+ * 
+ * @param event notification
+ * @param buffer output buffer
+ * @param size size of buffer, at least ALERT_EVENT_MAX_SIZE
+ * 
+ * @return int length of json
+ */
+int format_alert_event(const alert_event_t *event, char *buffer, size_t size) {
+    int len = snprintf(buffer, size, "{\"seq\":%lu,\"time\":%lu,\"rule\":%u,\"type\":\"%s\",\"channel\":%u,\"active\":%s,\"value\":",
+                       (unsigned long)event->sequence, (unsigned long)event->timestamp, event->rule, alert_type_names[event->type],
+                       event->channel, event->active ? "true" : "false");
+
+    if (event->value == TEMPERATURE_INVALID) {
+        len += snprintf(buffer + len, size - len, "null}");
+    } else {
+        len += snprintf(buffer + len, size - len, "%.2f}", event->value / 100.0);
+    }
+
+    return len;
+}
+
+/************************ ROLLUP ************************/
+
+/**
+ * @brief Function for reading records of sector of rollup tier.
+ * 
+ * @param tier rollup tier
+ * @param sector sector of ring
+ * @param index index of first record in sector
+ * @param records output records
+ * @param count count of records
+ * 
+ * @return bool true if records were read
+ */
+bool rollup_read(const rollup_tier_t *tier, uint32_t sector, uint32_t index, rollup_record_t *records, uint32_t count) {
+    size_t address = (tier->first_sector + sector) * LOG_SECTOR_SIZE + LOG_SECTOR_DATA_START + index * sizeof(rollup_record_t);
+
+    err = esp_partition_read(log_partition, address, records, count * sizeof(rollup_record_t));
+    if (err != ESP_OK) {
+        printf("Error - esp_partition_read(): %s\n", esp_err_to_name(err));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Function for starting new sector of rollup tier, oldest sector of ring is erased.
+ * 
+ * @param tier index of rollup tier
+ * @param sector sector of ring
+ * @param sequence sequence number of sector
+ */
+void rollup_start_sector(uint8_t tier, uint32_t sector, uint32_t sequence) {
+    rollup_tier_t *ring = &rollup_tiers[tier];
+    size_t address = (ring->first_sector + sector) * LOG_SECTOR_SIZE;
+    log_sector_header_t header = {
+        .magic = ROLLUP_SECTOR_MAGIC + tier,
+        .sequence = sequence,
+    };
+
+    err = esp_partition_erase_range(log_partition, address, LOG_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        printf("Error - esp_partition_erase_range(): %s\n", esp_err_to_name(err));
+    }
+
+    err = esp_partition_write(log_partition, address, &header, sizeof(header));
+    if (err != ESP_OK) {
+        printf("Error - esp_partition_write(): %s\n", esp_err_to_name(err));
+    }
+
+    ring->head_sector = sector;
+    ring->head_sequence = sequence;
+    ring->head_count = 0;
+    ring->index[sector].sequence = sequence;
+    ring->index[sector].first_timestamp = UINT32_MAX;
+}
+
+/**
+ * @brief Function for initialization of rollup tiers, rings follow each other from first sector to end of partition.
+ *        Head of ring is sector with highest sequence number, its free space starts at first erased record.
+ * 
+ * @param first_sector sector of partition where first ring starts
+ */
+void init_rollup_tiers(uint32_t first_sector) {
+    rollup_record_t records[ROLLUP_READ_RECORDS];
+    log_sector_header_t header;
+
+    for (uint8_t tier = 0; tier < ROLLUP_TIERS; tier++) {
+        rollup_tier_t *ring = &rollup_tiers[tier];
+        bool found = false;
+
+        ring->first_sector = first_sector;
+        ring->sector_count = rollup_tier_sectors[tier];
+        first_sector += ring->sector_count;
+
+        for (uint32_t sector = 0; sector < ring->sector_count; sector++) {
+            ring->index[sector].sequence = 0;
+            ring->index[sector].first_timestamp = UINT32_MAX;
+
+            err = esp_partition_read(log_partition, (ring->first_sector + sector) * LOG_SECTOR_SIZE, &header, sizeof(header));
+            if (err != ESP_OK || header.magic != ROLLUP_SECTOR_MAGIC + tier) {
+                continue;
+            }
+
+            ring->index[sector].sequence = header.sequence;
+            if (rollup_read(ring, sector, 0, records, 1) && records[0].timestamp != ROLLUP_FREE) {
+                ring->index[sector].first_timestamp = records[0].timestamp;
+            }
+
+            if (!found || (int32_t)(header.sequence - ring->head_sequence) > 0) {
+                ring->head_sector = sector;
+                ring->head_sequence = header.sequence;
+                found = true;
+            }
+        }
+
+        if (!found) { // tier was not used yet
+            rollup_start_sector(tier, 0, 0);
+            continue;
+        }
+
+        // records are appended, so first erased record is end of head sector
+        ring->head_count = 0;
+        while (ring->head_count < ROLLUP_SECTOR_RECORDS) {
+            uint32_t count = ROLLUP_SECTOR_RECORDS - ring->head_count;
+            if (count > ROLLUP_READ_RECORDS) {
+                count = ROLLUP_READ_RECORDS;
+            }
+
+            if (!rollup_read(ring, ring->head_sector, ring->head_count, records, count)) {
+                ring->head_count = ROLLUP_SECTOR_RECORDS; // sector is not appended anymore
+                break;
+            }
+
+            uint32_t used = 0;
+            while (used < count && records[used].timestamp != ROLLUP_FREE) {
+                ++used;
+            }
+            ring->head_count += used;
+            if (used < count) {
+                break;
+            }
+        }
+
+        printf("Rollup tier %lus initialized: sector %lu, sequence %lu, records %lu\n", (unsigned long)ring->period,
+               (unsigned long)ring->head_sector, (unsigned long)ring->head_sequence, (unsigned long)ring->head_count);
+    }
+}
+
+/**
+ * @brief Function for clearing all rollup tiers and their open periods.
+ */
+void clear_rollup_tiers() {
+    for (uint8_t tier = 0; tier < ROLLUP_TIERS; tier++) {
+        rollup_tier_t *ring = &rollup_tiers[tier];
+        if (ring->sector_count == 0) {
+            continue;
+        }
+
+        err = esp_partition_erase_range(log_partition, ring->first_sector * LOG_SECTOR_SIZE, ring->sector_count * LOG_SECTOR_SIZE);
+        if (err != ESP_OK) {
+            printf("Error - esp_partition_erase_range(): %s\n", esp_err_to_name(err));
+        }
+
+        for (uint32_t sector = 0; sector < ring->sector_count; sector++) {
+            ring->index[sector].first_timestamp = UINT32_MAX;
+        }
+        rollup_start_sector(tier, 0, 0);
+    }
+
+    memset(rollup_buckets, 0, sizeof(rollup_buckets));
+}
+
+/**
+ * @brief Function for appending record to ring of rollup tier.
+ *        Caller must hold log_mutex.
+ * 
+ * @param tier index of rollup tier
+ * @param record record
+ */
+void rollup_append(uint8_t tier, const rollup_record_t *record) {
+    rollup_tier_t *ring = &rollup_tiers[tier];
+
+    if (ring->sector_count == 0) {
+        return;
+    }
+
+    if (ring->head_count >= ROLLUP_SECTOR_RECORDS) { // sector is full -> continue with next sector
+        rollup_start_sector(tier, (ring->head_sector + 1) % ring->sector_count, ring->head_sequence + 1);
+    }
+
+    size_t address = (ring->first_sector + ring->head_sector) * LOG_SECTOR_SIZE + LOG_SECTOR_DATA_START + ring->head_count * sizeof(rollup_record_t);
+    err = esp_partition_write(log_partition, address, record, sizeof(*record));
+    if (err != ESP_OK) {
+        printf("Error - esp_partition_write(): %s\n", esp_err_to_name(err));
+        METRICS_COUNT(METRICS_COUNTER_COMMIT_FAILURES, 1);
+    }
+
+    if (ring->head_count == 0) {
+        ring->index[ring->head_sector].first_timestamp = record->timestamp;
+    }
+    ++ring->head_count;
+}
+
+/**
+ * @brief Function for converting open or closed period to rollup record.
+ * 
+ * @param bucket period with at least one sample
+ * @param channel index of channel
+ * @param record output record
+ */
+void rollup_record_from_bucket(const rollup_bucket_t *bucket, uint8_t channel, rollup_record_t *record) {
+    record->timestamp = bucket->start;
+    record->min = bucket->min;
+    record->max = bucket->max;
+    record->average = bucket->sum / bucket->count;
+    record->count = bucket->count > UINT16_MAX ? UINT16_MAX : bucket->count;
+    record->channel = channel;
+}
+
+/**
+ * @brief Function for adding samples to period of rollup tier.
+ *        Period which is left is written to ring of tier and added to next tier.
+ *        Caller must hold log_mutex.
+ * 
+ * @param tier index of rollup tier
+ * @param channel index of channel
+ * @param timestamp timestamp of samples
+ * @param min minimum of samples
+ * @param max maximum of samples
+ * @param sum sum of samples
+ * @param count count of samples
+ */
+void rollup_add(uint8_t tier, uint8_t channel, uint32_t timestamp, int16_t min, int16_t max, int64_t sum, uint32_t count) {
+    rollup_bucket_t *bucket = &rollup_buckets[tier][channel];
+    uint32_t start = timestamp - timestamp % rollup_tiers[tier].period;
+
+    if (bucket->count > 0 && bucket->start != start) {
+        rollup_record_t record;
+        rollup_bucket_t closed = *bucket;
+
+        bucket->count = 0;
+        rollup_record_from_bucket(&closed, channel, &record);
+        rollup_append(tier, &record);
+
+        if (tier + 1 < ROLLUP_TIERS) {
+            rollup_add(tier + 1, channel, closed.start, closed.min, closed.max, closed.sum, closed.count);
+        }
+    }
+
+    if (bucket->count == 0) {
+        bucket->start = start;
+        bucket->min = min;
+        bucket->max = max;
+        bucket->sum = 0;
+    }
+
+    if (min < bucket->min) {
+        bucket->min = min;
+    }
+    if (max > bucket->max) {
+        bucket->max = max;
+    }
+    bucket->sum += sum;
+    bucket->count += count;
+}
+
+/**
+ * @brief Function for adding record to first rollup tier, records without synchronized time are not rolled up.
+ *        Caller must hold log_mutex.
+ * 
+ * @param record record
+ */
+void rollup_record(const log_record_t *record) {
+    if (record->timestamp < TIME_VALID_EPOCH || record->channel >= CHANNEL_COUNT) {
+        return;
+    }
+
+    rollup_add(0, record->channel, record->timestamp, record->temperature, record->temperature, record->temperature, 1);
+}
+
+/**
+ * @brief Function for checking if sample at timestamp closes period of first rollup tier.
+ * 
+ * @param timestamp timestamp of sample
+ * 
+ * @return bool true if rollup record is written to flash with sample
+ */
+bool rollup_closes(uint32_t timestamp) {
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        const rollup_bucket_t *bucket = &rollup_buckets[0][channel];
+        if (timestamp >= TIME_VALID_EPOCH && bucket->count > 0 && bucket->start != timestamp - timestamp % rollup_tiers[0].period) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Function for counting sectors of rollup tier which belong to ring, going back from head as long as sequence numbers follow.
+ * 
+ * @param ring rollup tier
+ * @param head_sector head sector of ring
+ * @param head_sequence sequence number of head sector
+ * 
+ * @return uint32_t count of sectors with records
+ */
+uint32_t rollup_sectors_in_use(const rollup_tier_t *ring, uint32_t head_sector, uint32_t head_sequence) {
+    uint32_t sectors = 1;
+
+    while (sectors < ring->sector_count) {
+        const log_index_entry_t *entry = &ring->index[(head_sector + ring->sector_count - sectors) % ring->sector_count];
+        if (entry->sequence != head_sequence - sectors || entry->first_timestamp == UINT32_MAX) {
+            break;
+        }
+        ++sectors;
+    }
+
+    return sectors;
+}
+
+/**
+ * @brief Function for getting timestamp of oldest record of rollup tier.
+ * 
+ * @param tier index of rollup tier
+ * 
+ * @return uint32_t timestamp of oldest record, UINT32_MAX if tier is empty
+ */
+uint32_t rollup_oldest_timestamp(uint8_t tier) {
+    const rollup_tier_t *ring = &rollup_tiers[tier];
+
+    if (ring->sector_count == 0) {
+        return UINT32_MAX;
+    }
+
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    uint32_t head_sector = ring->head_sector;
+    uint32_t head_sequence = ring->head_sequence;
+    xSemaphoreGive(log_mutex);
+
+    uint32_t sectors = rollup_sectors_in_use(ring, head_sector, head_sequence);
+    return ring->index[(head_sector + ring->sector_count - (sectors - 1)) % ring->sector_count].first_timestamp;
+}
+
+/**
+ * @brief Function for visiting records of rollup tier in chronological order, starting with first period not older than from.
+ *        Start sector is found by binary search in time index, open periods are visited last.
+ * 
+ * @param tier index of rollup tier
+ * @param from timestamp of first visited period
+ * @param visitor function called for every record
+ * @param ctx context of visitor
+ */
+void rollup_visit_from(uint8_t tier, uint32_t from, rollup_visitor_t visitor, void *ctx) {
+    const rollup_tier_t *ring = &rollup_tiers[tier];
+    rollup_record_t records[ROLLUP_READ_RECORDS];
+    rollup_record_t open[CHANNEL_COUNT];
+    uint8_t open_count = 0;
+
+    // snapshot of head, flash behind it is not written anymore
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    uint32_t head_sector = ring->head_sector;
+    uint32_t head_sequence = ring->head_sequence;
+    uint32_t head_count = ring->head_count;
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (rollup_buckets[tier][channel].count > 0) {
+            rollup_record_from_bucket(&rollup_buckets[tier][channel], channel, &open[open_count++]);
+        }
+    }
+    xSemaphoreGive(log_mutex);
+
+    if (ring->sector_count > 0) {
+        uint32_t sectors = rollup_sectors_in_use(ring, head_sector, head_sequence);
+
+        // newest sector which starts not later than from, age counted from head
+        uint32_t low = 0;
+        uint32_t high = sectors - 1;
+        while (low < high) {
+            uint32_t middle = (low + high) / 2;
+            if (ring->index[(head_sector + ring->sector_count - middle) % ring->sector_count].first_timestamp <= from) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+
+        for (int32_t age = high; age >= 0; age--) {
+            uint32_t sector = (head_sector + ring->sector_count - age) % ring->sector_count;
+            uint32_t limit = age == 0 ? head_count : ROLLUP_SECTOR_RECORDS;
+
+            if (ring->index[sector].sequence != head_sequence - age) { // sector was reused meanwhile
+                continue;
+            }
+
+            for (uint32_t index = 0; index < limit; index += ROLLUP_READ_RECORDS) {
+                uint32_t count = limit - index < ROLLUP_READ_RECORDS ? limit - index : ROLLUP_READ_RECORDS;
+                if (!rollup_read(ring, sector, index, records, count)) {
+                    break;
+                }
+
+                for (uint32_t i = 0; i < count; i++) {
+                    if (records[i].timestamp == ROLLUP_FREE) { // end of sector which was not filled
+                        index = limit;
+                        break;
+                    }
+                    if (records[i].timestamp >= from && !visitor(&records[i], ctx)) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < open_count; i++) {
+        if (open[i].timestamp >= from && !visitor(&open[i], ctx)) {
+            return;
+        }
+    }
+}
+
+/************************ NON-VOLATILE MEMORY ************************/
+
+/**
+ * @brief Function for reading header of sector.
+ * 
+ * @param sector sector index
+ * @param header output header
+ * 
+ * @return bool true if sector is initialized
+ */
+bool log_read_header(uint32_t sector, log_sector_header_t *header) {
+    err = esp_partition_read(log_partition, sector * LOG_SECTOR_SIZE, header, sizeof(log_sector_header_t));
+    if (err != ESP_OK) {
+        printf("Error - esp_partition_read(): %s\n", esp_err_to_name(err));
+        return false;
+    }
+
+    return header->magic == LOG_SECTOR_MAGIC;
+}
+
+/**
+ * @brief Function for starting streaming read of records of sector.
+ * 
+ * @param reader reader
+ * @param sector sector index
+ * @param limit end of blocks in sector, LOG_SECTOR_SIZE if sector is not written anymore
+ */
+void log_reader_init(log_sector_reader_t *reader, uint32_t sector, size_t limit) {
+    reader->sector = sector;
+    reader->offset = LOG_SECTOR_DATA_START;
+    reader->limit = limit;
+    reader->decoding = false;
+}
+
+/**
+ * @brief Function for reading next block of sector to reader, damaged blocks are skipped.
+ * 
+ * @param reader reader
+ * 
+ * @return bool false at end of blocks
+ */
+bool log_reader_next_block(log_sector_reader_t *reader) {
+    log_block_header_t header;
+
+    while (reader->offset + sizeof(header) <= reader->limit) {
+        size_t address = reader->sector * LOG_SECTOR_SIZE + reader->offset;
+
+        err = esp_partition_read(log_partition, address, &header, sizeof(header));
+        if (err != ESP_OK) {
+            printf("Error - esp_partition_read(): %s\n", esp_err_to_name(err));
+            return false;
+        }
+
+        // free space or damaged length, position of next block is unknown
+        if (header.length == LOG_BLOCK_FREE || header.length < sizeof(header) || header.length > LOG_BLOCK_MAX_SIZE ||
+            reader->offset + header.length > reader->limit) {
+            return false;
+        }
+
+        err = esp_partition_read(log_partition, address, reader->block, header.length);
+        if (err != ESP_OK) {
+            printf("Error - esp_partition_read(): %s\n", esp_err_to_name(err));
+            return false;
+        }
+        reader->offset += header.length;
+
+        if (log_block_check(reader->block, header.length) == header.check) {
+            log_decoder_init(&reader->decoder, reader->block);
+            return true;
+        }
+        printf("Error - log_reader_next_block(): damaged block in sector %lu\n", (unsigned long)reader->sector);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Function for reading next record of sector, blocks are read and decoded one by one.
+ * 
+ * @param reader reader
+ * @param record output record
+ * 
+ * @return bool false at end of records
+ */
+bool log_reader_next(log_sector_reader_t *reader, log_record_t *record) {
+    while (1) {
+        if (reader->decoding && log_decoder_next(&reader->decoder, record)) {
+            return true;
+        }
+
+        reader->decoding = log_reader_next_block(reader);
+        if (!reader->decoding) {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief Function for starting new sector of record log.
+ *        Sectors are used in ring, so every sector is erased equally often.
+ * 
+ * @param sector sector index
+ * @param sequence sequence number of sector
+ */
+void log_start_sector(uint32_t sector, uint32_t sequence) {
+    log_sector_header_t header = {
+        .magic = LOG_SECTOR_MAGIC,
+        .sequence = sequence,
+    };
+
+    err = esp_partition_erase_range(log_partition, sector * LOG_SECTOR_SIZE, LOG_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        printf("Error - esp_partition_erase_range(): %s\n", esp_err_to_name(err));
+    }
+
+    err = esp_partition_write(log_partition, sector * LOG_SECTOR_SIZE, &header, sizeof(header));
+    if (err != ESP_OK) {
+        printf("Error - esp_partition_write(): %s\n", esp_err_to_name(err));
+    }
+
+    log_head_sector = sector;
+    log_head_sequence = sequence;
+    log_head_offset = LOG_SECTOR_DATA_START;
+    log_head_count = 0;
+    log_index[sector].sequence = sequence;
+    log_index[sector].first_timestamp = UINT32_MAX;
+}
+
+/**
+ * @brief Function for initialization of record log.
+ *        Head of log is sector with highest sequence number, its free space starts after last block.
+ */
+void init_record_log() {
+    static log_sector_reader_t reader; // too large for stack of main task
+    log_sector_header_t header;
+    bool found = false;
+
+    log_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, LOG_PARTITION_SUBTYPE, LOG_PARTITION_LABEL);
+    if (log_partition == NULL) {
+        printf("Error - esp_partition_find_first(): partition %s not found\n", LOG_PARTITION_LABEL);
+        return;
+    }
+
+    // rollup tiers take sectors at end of partition, raw records the rest
+    uint32_t partition_sectors = log_partition->size / LOG_SECTOR_SIZE;
+    uint32_t rollup_sectors = 0;
+    for (uint8_t tier = 0; tier < ROLLUP_TIERS; tier++) {
+        rollup_sectors += rollup_tier_sectors[tier];
+    }
+    if (partition_sectors < rollup_sectors + 2) {
+        printf("Error - init_record_log(): partition too small for rollup tiers\n");
+        rollup_sectors = 0;
+    } else {
+        init_rollup_tiers(partition_sectors - rollup_sectors);
+    }
+
+    log_sector_count = partition_sectors - rollup_sectors;
+    if (log_sector_count > LOG_MAX_SECTORS) {
+        log_sector_count = LOG_MAX_SECTORS;
+    }
+
+    for (uint32_t sector = 0; sector < log_sector_count; sector++) {
+        log_index[sector].sequence = 0;
+        log_index[sector].first_timestamp = UINT32_MAX;
+
+        if (!log_read_header(sector, &header)) {
+            continue;
+        }
+
+        log_index[sector].sequence = header.sequence;
+        log_reader_init(&reader, sector, LOG_SECTOR_SIZE);
+        if (log_reader_next_block(&reader)) {
+            log_index[sector].first_timestamp = reader.decoder.header.base_timestamp;
+        }
+
+        if (!found || (int32_t)(header.sequence - log_head_sequence) > 0) {
+            log_head_sector = sector;
+            log_head_sequence = header.sequence;
+            found = true;
+        }
+    }
+
+    if (!found) { // empty partition
+        log_start_sector(0, 0);
+        return;
+    }
+
+    // blocks are appended, so free space is always at the end of sector
+    log_head_count = 0;
+    log_reader_init(&reader, log_head_sector, LOG_SECTOR_SIZE);
+    while (log_reader_next_block(&reader)) {
+        log_head_count += reader.decoder.header.count;
+    }
+    log_head_offset = reader.offset;
+
+    // length of next block is damaged, sector can not be appended anymore
+    uint16_t length = LOG_BLOCK_FREE;
+    if (log_head_offset + sizeof(length) <= LOG_SECTOR_SIZE) {
+        esp_partition_read(log_partition, log_head_sector * LOG_SECTOR_SIZE + log_head_offset, &length, sizeof(length));
+    }
+    if (length != LOG_BLOCK_FREE) {
+        log_head_offset = LOG_SECTOR_SIZE;
+    }
+
+    printf("Record log initialized: sector %lu, sequence %lu, offset %lu, records %lu\n",
+           (unsigned long)log_head_sector, (unsigned long)log_head_sequence, (unsigned long)log_head_offset, (unsigned long)log_head_count);
+}
+
+/**
+ * @brief Function for writing records buffered in RAM to flash as one block.
+ *        Caller must hold log_mutex.
+ */
+void flush_record_log() {
+    static uint8_t block[LOG_BLOCK_MAX_SIZE]; // guarded by log_mutex
+
+    if (log_partition == NULL) {
+        log_batch.count = 0;
+        return;
+    }
+
+    if (log_batch.count == 0) {
+        return;
+    }
+
+    // records taken before time synchronization get actual time if it is known now
+    for (uint16_t i = 0; i < log_batch.count; i++) {
+        log_record_t *record = &log_batch.records[i];
+        if (record->timestamp < TIME_VALID_EPOCH) {
+            record->timestamp = resolve_timestamp(record->timestamp);
+        }
+    }
+
+    METRICS_START(start);
+    uint16_t length = log_encode_block(log_batch.records, log_batch.count, block);
+    if (log_head_offset + length > LOG_SECTOR_SIZE) { // block does not fit -> continue with next sector
+        log_start_sector((log_head_sector + 1) % log_sector_count, log_head_sequence + 1);
+    }
+
+    err = esp_partition_write(log_partition, log_head_sector * LOG_SECTOR_SIZE + log_head_offset, block, length);
+    if (err != ESP_OK) {
+        // block may be partly written, so sector is closed and batch stays in staging buffer for next flush
+        printf("Error - esp_partition_write(): %s\n", esp_err_to_name(err));
+        METRICS_COUNT(METRICS_COUNTER_COMMIT_FAILURES, 1);
+        log_head_offset = LOG_SECTOR_SIZE;
+        return;
+    }
+    METRICS_STAGE_STOP(METRICS_STAGE_FLASH_WRITE, start);
+    METRICS_COUNT(METRICS_COUNTER_FLASH_WRITES, 1);
+
+    if (log_head_count == 0) {
+        log_index[log_head_sector].first_timestamp = log_batch.records[0].timestamp;
+    }
+
+    log_head_offset += length;
+    log_head_count += log_batch.count;
+    log_batch.count = 0;
+}
+
+/**
+ * @brief Function for clearing memory.
+ */
+void clear_memory() {
+    if (log_partition == NULL) {
+        return;
+    }
+
+    METRICS_COUNT(METRICS_COUNTER_MEMORY_CLEARS, 1);
+    err = esp_partition_erase_range(log_partition, 0, log_sector_count * LOG_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        printf("Error - esp_partition_erase_range(): %s\n", esp_err_to_name(err));
+    }
+
+    for (uint32_t sector = 0; sector < log_sector_count; sector++) {
+        log_index[sector].first_timestamp = UINT32_MAX;
+    }
+
+    log_batch.count = 0;
+    log_start_sector(0, 0);
+    clear_rollup_tiers();
+}
+
+/**
+ * @brief Function for periodic flush of staging buffer, called by commit timer.
+ * 
+ * @param arg unused
+ */
+void log_commit_timer_callback(void *arg) {
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    if (log_batch.count > 0) {
+        flush_record_log();
+    }
+    xSemaphoreGive(log_mutex);
+}
+
+/**
+ * @brief Function for flushing staging buffer before software reset.
+ */
+void log_shutdown_handler() {
+    if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        flush_record_log();
+        xSemaphoreGive(log_mutex);
+    }
+}
+
+/**
+ * @brief Function for checking if staging buffer in RTC memory survived reset or deep sleep.
+ * 
+ * @return bool true if staging buffer contains valid records
+ */
+bool log_batch_valid() {
+    return log_batch.magic == LOG_BATCH_MAGIC && log_batch.count <= LOG_BATCH_MAX_RECORDS && esp_reset_reason() != ESP_RST_POWERON;
+}
+
+/**
+ * @brief Function for initialization of staging buffer and its flush triggers.
+ *        Records which survived reset in RTC memory are written first.
+ */
+void init_record_log_batch() {
+    log_mutex = create_mutex(STATIC_BUFFER(&log_mutex_buffer));
+
+    if (log_batch_valid()) {
+        printf("Recovering %u records from staging buffer\n", log_batch.count);
+        flush_record_log(); // records stay in buffer if write fails
+    } else {
+        log_batch.count = 0;
+    }
+    log_batch.magic = LOG_BATCH_MAGIC;
+
+    if (log_batch_size == 0 || log_batch_size > LOG_BATCH_MAX_RECORDS) {
+        log_batch_size = LOG_BATCH_MAX_RECORDS;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = log_commit_timer_callback,
+        .name = "log_commit",
+    };
+    err = esp_timer_create(&timer_args, &log_commit_timer);
+    if (err != ESP_OK) {
+        printf("Error - esp_timer_create(): %s\n", esp_err_to_name(err));
+    }
+
+    err = esp_timer_start_periodic(log_commit_timer, (uint64_t)log_commit_interval_ms * 1000);
+    if (err != ESP_OK) {
+        printf("Error - esp_timer_start_periodic(): %s\n", esp_err_to_name(err));
+    }
+
+    err = esp_register_shutdown_handler(log_shutdown_handler);
+    if (err != ESP_OK) {
+        printf("Error - esp_register_shutdown_handler(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Function for storing sample to memory, one record per channel with value.
+ *        Records are only copied to RAM staging buffer, flash is written once the batch is full.
+ * 
+ * @param sample sample
+ */
+void store_temperature(const sample_t *sample) {
+    uint32_t timestamp = (uint32_t)(resolve_time_us(sample->time_us) / 1000000);
+
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (sample->temperature[channel] == TEMPERATURE_INVALID) {
+            continue;
+        }
+
+        if (log_batch.count >= LOG_BATCH_MAX_RECORDS) { // flushes failed and staging buffer is full
+            ++dropped_records;
+            continue;
+        }
+
+        log_record_t *record = &log_batch.records[log_batch.count];
+
+        record->timestamp = timestamp;
+        record->temperature = sample->temperature[channel];
+        record->channel = channel;
+        rollup_record(record);
+
+        if (++log_batch.count >= log_batch_size) {
+            flush_record_log();
+        }
+    }
+
+    xSemaphoreGive(log_mutex);
+}
+
+/**
+ * @brief Function for visiting records in chronological order, starting with first record not older than from.
+ *        Start sector is found by binary search in time index, blocks are decoded while they are visited
+ *        and records in staging buffer are visited last.
+ * 
+ * @param from timestamp of first visited record
+ * @param visitor function called for every record
+ * @param ctx context of visitor
+ */
+void log_visit_from(uint32_t from, log_visitor_t visitor, void *ctx) {
+    log_sector_reader_t reader;
+    log_record_t record;
+    log_record_t pending[LOG_BATCH_MAX_RECORDS];
+
+    // snapshot of head, flash behind it is not written anymore
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    uint32_t head_sector = log_head_sector;
+    uint32_t head_sequence = log_head_sequence;
+    size_t head_offset = log_head_offset;
+    uint16_t pending_count = log_batch.count;
+    memcpy(pending, log_batch.records, pending_count * sizeof(log_record_t));
+    xSemaphoreGive(log_mutex);
+
+    for (uint16_t i = 0; i < pending_count; i++) {
+        pending[i].timestamp = resolve_timestamp(pending[i].timestamp);
+    }
+
+    if (log_partition != NULL) {
+        // count of sectors in log, going back from head as long as sequence numbers follow
+        uint32_t sectors = 1;
+        while (sectors < log_sector_count) {
+            log_index_entry_t *entry = &log_index[(head_sector + log_sector_count - sectors) % log_sector_count];
+            if (entry->sequence != head_sequence - sectors || entry->first_timestamp == UINT32_MAX) {
+                break;
+            }
+            ++sectors;
+        }
+
+        // newest sector which starts not later than from, age counted from head
+        uint32_t low = 0;
+        uint32_t high = sectors - 1;
+        while (low < high) {
+            uint32_t middle = (low + high) / 2;
+            if (log_index[(head_sector + log_sector_count - middle) % log_sector_count].first_timestamp <= from) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+
+        for (int32_t age = high; age >= 0; age--) {
+            uint32_t sector = (head_sector + log_sector_count - age) % log_sector_count;
+
+            if (log_index[sector].sequence != head_sequence - age) { // sector was reused meanwhile
+                continue;
+            }
+
+            log_reader_init(&reader, sector, age == 0 ? head_offset : LOG_SECTOR_SIZE);
+            while (log_reader_next(&reader, &record)) {
+                if (record.timestamp >= from && !visitor(&record, ctx)) {
+                    return;
+                }
+            }
+        }
+    }
+
+    for (uint16_t i = 0; i < pending_count; i++) {
+        if (pending[i].timestamp >= from && !visitor(&pending[i], ctx)) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Function for getting timestamp of oldest flushed record.
+ * 
+ * @return uint32_t timestamp of first record of oldest sector, UINT32_MAX if log is empty
+ */
+uint32_t log_oldest_timestamp() {
+    if (log_partition == NULL) {
+        return UINT32_MAX;
+    }
+
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    uint32_t head_sector = log_head_sector;
+    uint32_t head_sequence = log_head_sequence;
+    xSemaphoreGive(log_mutex);
+
+    uint32_t sectors = 1;
+    while (sectors < log_sector_count) {
+        log_index_entry_t *entry = &log_index[(head_sector + log_sector_count - sectors) % log_sector_count];
+        if (entry->sequence != head_sequence - sectors || entry->first_timestamp == UINT32_MAX) {
+            break;
+        }
+        ++sectors;
+    }
+
+    return log_index[(head_sector + log_sector_count - (sectors - 1)) % log_sector_count].first_timestamp;
+}
+
+/**
+ * @brief Function for reading flushed records starting at given position.
+ *        Position of records overwritten by ring is moved to oldest record still in log.
+ * 
+ * @param position position of first record, updated to position after last read record
+ * @param records output records
+ * @param max maximal count of records
+ * 
+ * @return uint16_t count of read records
+ */
+uint16_t log_read_position(uint64_t *position, log_record_t *records, uint16_t max) {
+    log_sector_reader_t reader;
+    log_record_t record;
+    uint16_t count = 0;
+
+    if (log_partition == NULL) {
+        return 0;
+    }
+
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    uint32_t head_sector = log_head_sector;
+    uint32_t head_sequence = log_head_sequence;
+    size_t head_offset = log_head_offset;
+    uint64_t head_position = LOG_POSITION(log_head_sequence, log_head_count);
+    xSemaphoreGive(log_mutex);
+
+    // oldest sector still in log
+    uint32_t sectors = 1;
+    while (sectors < log_sector_count && log_index[(head_sector + log_sector_count - sectors) % log_sector_count].sequence == head_sequence - sectors) {
+        ++sectors;
+    }
+    uint64_t oldest_position = LOG_POSITION(head_sequence - (sectors - 1), 0);
+
+    if (*position < oldest_position) {
+        printf("Error - log_read_position(): records before position %llu overwritten\n", (unsigned long long)oldest_position);
+        *position = oldest_position;
+    } else if (*position > head_position) { // memory was cleared
+        *position = oldest_position;
+    }
+
+    while (count < max && *position < head_position) {
+        uint32_t sequence = *position / LOG_POSITION_STRIDE;
+        uint32_t index = *position % LOG_POSITION_STRIDE;
+        uint32_t sector = (head_sector + log_sector_count - (head_sequence - sequence)) % log_sector_count;
+
+        // blocks have variable length, so sector is decoded from its start
+        log_reader_init(&reader, sector, sequence == head_sequence ? head_offset : LOG_SECTOR_SIZE);
+        for (uint32_t i = 0; count < max && log_reader_next(&reader, &record); i++) {
+            if (i >= index) {
+                records[count++] = record;
+                ++*position;
+            }
+        }
+
+        if (count < max) { // end of sector
+            if (sequence == head_sequence) {
+                break;
+            }
+            *position = LOG_POSITION(sequence + 1, 0);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Record visitor which keeps last records for history cache.
+ * 
+ * @param record record
+ * @param ctx history load
+ * 
+ * @return bool true, all records are visited
+ */
+bool history_load_visit_record(const log_record_t *record, void *ctx) {
+    history_load_t *load = ctx;
+
+    load->records[load->head] = *record;
+    load->head = (load->head + 1) % (HISTORY_SIZE * CHANNEL_COUNT);
+    if (load->count < HISTORY_SIZE * CHANNEL_COUNT) {
+        ++load->count;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Function for filling history cache with last records from memory.
+ *        Records of sector before head and of head sector are decoded,
+ *        records of channels with same timestamp are joined to one sample.
+ */
+void load_history_from_nvm() {
+    static history_load_t load; // too large for stack of main task
+    uint32_t previous = (log_head_sector + log_sector_count - 1) % log_sector_count;
+    uint32_t from = log_index[log_head_sector].first_timestamp;
+
+    if (log_partition == NULL) {
+        return;
+    }
+
+    if (log_sector_count > 1 && log_index[previous].sequence == log_head_sequence - 1 && log_index[previous].first_timestamp != UINT32_MAX) {
+        from = log_index[previous].first_timestamp;
+    }
+
+    load.head = 0;
+    load.count = 0;
+    log_visit_from(from, history_load_visit_record, &load);
+
+    // oldest record first
+    sample_t sample;
+    bool joined = false;
+    for (uint16_t i = 0; i < load.count; i++) {
+        const log_record_t *record = &load.records[(load.head + HISTORY_SIZE * CHANNEL_COUNT - load.count + i) % (HISTORY_SIZE * CHANNEL_COUNT)];
+
+        if (joined && (int64_t)record->timestamp * 1000000 != sample.time_us) {
+            publish_sample(&sample);
+            joined = false;
+        }
+
+        if (!joined) {
+            sample.time_us = (int64_t)record->timestamp * 1000000;
+            for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+                sample.temperature[channel] = TEMPERATURE_INVALID;
+            }
+            joined = true;
+        }
+
+        if (record->channel < CHANNEL_COUNT) {
+            sample.temperature[record->channel] = record->temperature;
+        }
+    }
+
+    if (joined) {
+        publish_sample(&sample);
+    }
+}
+
+/************************ SETTINGS ************************/
+
+/**
+ * @brief Function for copying working settings from globals.
+ * 
+ * @param settings output settings
+ */
+void settings_capture(settings_t *settings) {
+    channel_t config[CHANNEL_COUNT];
+
+    memset(settings, 0, sizeof(*settings));
+    settings->version = SETTINGS_VERSION;
+    settings->size = sizeof(settings_t);
+
+    read_channels(config, &settings->hysteresis);
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        settings->threshold[channel] = config[channel].threshold;
+        settings->gain[channel] = config[channel].gain;
+        settings->offset[channel] = config[channel].offset;
+    }
+
+    settings->threshold_input = threshold_input;
+    settings->adaptive_sampling = adaptive_sampling;
+    settings->sample_period_ms = sample_period_ms;
+    settings->adaptive_period_min_ms = adaptive_period_min_ms;
+    settings->adaptive_period_max_ms = adaptive_period_max_ms;
+    strlcpy(settings->wifi_ssid, wifi_sta_ssid, sizeof(settings->wifi_ssid));
+    strlcpy(settings->wifi_password, wifi_sta_password, sizeof(settings->wifi_password));
+    strlcpy(settings->ntp_server, ntp_server, sizeof(settings->ntp_server));
+    strlcpy(settings->uplink_url, uplink_url, sizeof(settings->uplink_url));
+    settings->uplink_interval_ms = uplink_interval_ms;
+    settings->conversion_mode = conversion_mode;
+    settings->low_power_mode = low_power_mode;
+    settings->log_batch_size = log_batch_size;
+    settings->log_commit_interval_ms = log_commit_interval_ms;
+    settings->adc_filter = adc_filter;
+    settings->adc_sample_rate_hz = adc_sample_rate_hz;
+}
+
+/**
+ * @brief Function for applying settings to globals.
+ *        Changed threshold, conversion and filter are used from next sample, changed rate reconfigures ADC at once,
+ *        wifi, sntp and uplink settings are used from next boot.
+ *        Channel table is written under channel_lock, led follows reset threshold state with next sample.
+ *        Enabled low power mode returns device to deep sleep after AWAKE_TIME_MS, disabled keeps it awake.
+ *        Smaller batch is flushed with next record, changed commit interval restarts commit timer.
+ * 
+ * @param settings settings
+ */
+void settings_apply(const settings_t *settings) {
+    portENTER_CRITICAL(&channel_lock);
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (channels[channel].threshold != settings->threshold[channel]) {
+            channels[channel].threshold = settings->threshold[channel];
+            channels[channel].threshold_overcome = false;
+        }
+        channels[channel].gain = settings->gain[channel];
+        channels[channel].offset = settings->offset[channel];
+    }
+    threshold_hysteresis = settings->hysteresis;
+    portEXIT_CRITICAL(&channel_lock);
+
+    // adaptive sampling starts from configured period
+    if (sample_period_ms != settings->sample_period_ms || adaptive_sampling != settings->adaptive_sampling) {
+        current_period_ms = settings->sample_period_ms;
+    }
+
+    threshold_input = settings->threshold_input;
+    adaptive_sampling = settings->adaptive_sampling;
+    sample_period_ms = settings->sample_period_ms;
+    adaptive_period_min_ms = settings->adaptive_period_min_ms;
+    adaptive_period_max_ms = settings->adaptive_period_max_ms;
+    strlcpy(wifi_sta_ssid, settings->wifi_ssid, sizeof(wifi_sta_ssid));
+    strlcpy(wifi_sta_password, settings->wifi_password, sizeof(wifi_sta_password));
+    strlcpy(ntp_server, settings->ntp_server, sizeof(ntp_server));
+    strlcpy(uplink_url, settings->uplink_url, sizeof(uplink_url));
+    uplink_interval_ms = settings->uplink_interval_ms;
+    conversion_mode = settings->conversion_mode;
+    adc_filter = settings->adc_filter;
+    if (adc_sample_rate_hz != settings->adc_sample_rate_hz) {
+        set_adc_sample_rate(settings->adc_sample_rate_hz);
+    }
+    log_batch_size = settings->log_batch_size;
+
+    if (log_commit_interval_ms != settings->log_commit_interval_ms) {
+        log_commit_interval_ms = settings->log_commit_interval_ms;
+        if (log_commit_timer != NULL) { // timer is started with loaded interval at boot
+            esp_timer_stop(log_commit_timer);
+            err = esp_timer_start_periodic(log_commit_timer, (uint64_t)log_commit_interval_ms * 1000);
+            if (err != ESP_OK) {
+                printf("Error - esp_timer_start_periodic(): %s\n", esp_err_to_name(err));
+            }
+        }
+    }
+
+    if (low_power_mode != settings->low_power_mode) {
+        low_power_mode = settings->low_power_mode;
+        if (awake_timer != NULL) { // timer exists once device runs, mode loaded at boot is handled by app_main
+            esp_timer_stop(awake_timer);
+            if (low_power_mode) {
+                esp_timer_start_once(awake_timer, (uint64_t)AWAKE_TIME_MS * 1000);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Function for checking if settings are valid.
+ * 
+ * @param settings settings
+ * 
+ * @return bool true if all values are in range
+ */
+bool settings_valid(const settings_t *settings) {
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (!isfinite(settings->threshold[channel]) || !isfinite(settings->gain[channel]) || settings->gain[channel] == 0.0 || !isfinite(settings->offset[channel])) {
+            return false;
+        }
+    }
+
+    return isfinite(settings->hysteresis) && settings->hysteresis >= 0.0 &&
+           settings->threshold_input <= THRESHOLD_INPUT_EWMA &&
+           settings->sample_period_ms >= SAMPLE_PERIOD_MIN_MS && settings->sample_period_ms <= SAMPLE_PERIOD_MAX_MS &&
+           settings->adaptive_period_min_ms >= SAMPLE_PERIOD_MIN_MS && settings->adaptive_period_max_ms <= SAMPLE_PERIOD_MAX_MS &&
+           settings->adaptive_period_min_ms <= settings->adaptive_period_max_ms &&
+           settings->uplink_interval_ms > 0 && settings->conversion_mode <= CONVERSION_LUT_INTERPOLATED &&
+           settings->log_batch_size >= 1 && settings->log_batch_size <= LOG_BATCH_MAX_RECORDS && settings->log_commit_interval_ms > 0 &&
+           settings->adc_filter <= ADC_FILTER_MEDIAN &&
+           settings->adc_sample_rate_hz >= ADC_SAMPLE_RATE_MIN_HZ && settings->adc_sample_rate_hz <= ADC_SAMPLE_RATE_MAX_HZ;
+}
+
+/**
+ * @brief Function for writing settings to memory, unchanged settings are not written.
+ */
+void save_settings() {
+    nvs_handle_t memory_handle;
+    settings_t settings;
+    alert_rule_t rules[ALERT_RULES_MAX];
+
+    settings_capture(&settings);
+    alert_rules_capture(rules);
+    bool settings_same = memcmp(&settings, &settings_saved, sizeof(settings)) == 0;
+    bool rules_same = memcmp(rules, alert_rules_saved, sizeof(rules)) == 0;
+    if (settings_same && rules_same) {
+        return;
+    }
+
+    err = nvs_open(settings_memory_name, NVS_READWRITE, &memory_handle);
+    if (err != ESP_OK) {
+        printf("Error - nvs_open(): %s\n", esp_err_to_name(err));
+        return;
+    }
+
+    if (!settings_same) {
+        err = nvs_set_blob(memory_handle, settings_memory_blob, &settings, sizeof(settings));
+        if (err != ESP_OK) {
+            printf("Error - nvs_set_blob(): %s\n", esp_err_to_name(err));
+        }
+    }
+    if (!rules_same) {
+        err = nvs_set_blob(memory_handle, alert_memory_blob, rules, sizeof(rules));
+        if (err != ESP_OK) {
+            printf("Error - nvs_set_blob(): %s\n", esp_err_to_name(err));
+        }
+    }
+
+    METRICS_START(start);
+    err = nvs_commit(memory_handle);
+    if (err != ESP_OK) {
+        printf("Error - nvs_commit(): %s\n", esp_err_to_name(err));
+        METRICS_COUNT(METRICS_COUNTER_COMMIT_FAILURES, 1);
+    } else {
+        settings_saved = settings;
+        memcpy(alert_rules_saved, rules, sizeof(rules));
+    }
+    METRICS_STAGE_STOP(METRICS_STAGE_NVS_COMMIT, start);
+
+    nvs_close(memory_handle);
+}
+
+/**
+ * @brief Function called when settings did not change for SETTINGS_SAVE_DELAY_MS.
+ * 
+ * @param arg unused
+ */
+void settings_timer_callback(void *arg) {
+    save_settings();
+}
+
+/**
+ * @brief Function for writing pending settings at once, before software reset or deep sleep.
+ */
+void flush_settings() {
+    if (settings_timer != NULL && esp_timer_is_active(settings_timer)) {
+        esp_timer_stop(settings_timer);
+        save_settings();
+    }
+}
+
+/**
+ * @brief Function for marking settings as changed, burst of changes is written once after SETTINGS_SAVE_DELAY_MS.
+ */
+void settings_changed() {
+    if (settings_timer == NULL) {
+        return;
+    }
+
+    esp_timer_stop(settings_timer);
+    err = esp_timer_start_once(settings_timer, (uint64_t)SETTINGS_SAVE_DELAY_MS * 1000);
+    if (err != ESP_OK) {
+        printf("Error - esp_timer_start_once(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Function for loading alert rules from memory at boot, all rules stay off if blob is missing or invalid.
+ * 
+ * @param memory_handle handle of settings memory
+ */
+void load_alert_rules(nvs_handle_t memory_handle) {
+    alert_rule_t rules[ALERT_RULES_MAX];
+    size_t size = sizeof(rules);
+
+    err = nvs_get_blob(memory_handle, alert_memory_blob, rules, &size);
+    if (err != ESP_OK || size != sizeof(rules)) {
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            printf("Error - load_alert_rules(): alert rules in memory are invalid, rules are off\n");
+        }
+        return;
+    }
+
+    for (uint8_t i = 0; i < ALERT_RULES_MAX; i++) {
+        if (!alert_rule_valid(&rules[i])) {
+            printf("Error - load_alert_rules(): alert rules in memory are invalid, rules are off\n");
+            return;
+        }
+    }
+
+    alert_rules_apply(rules);
+    memcpy(alert_rules_saved, rules, sizeof(rules));
+}
+
+/**
+ * @brief Function for loading settings from memory at boot, compiled defaults are kept if blob is missing or invalid.
+ */
+void load_settings() {
+    nvs_handle_t memory_handle;
+    settings_t settings;
+    size_t size = sizeof(settings);
+
+    settings_capture(&settings_saved);
+    alert_rules_capture(alert_rules_saved);
+
+    err = nvs_open(settings_memory_name, NVS_READWRITE, &memory_handle);
+    if (err != ESP_OK) {
+        printf("Error - nvs_open(): %s\n", esp_err_to_name(err));
+    } else {
+        err = nvs_get_blob(memory_handle, settings_memory_blob, &settings, &size);
+        if (err == ESP_OK && size == sizeof(settings) && settings.version == SETTINGS_VERSION &&
+            settings.size == sizeof(settings) && settings_valid(&settings)) {
+            settings_apply(&settings);
+            settings_saved = settings;
+        } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+            printf("Error - load_settings(): settings in memory are invalid, defaults are used\n");
+        }
+        load_alert_rules(memory_handle);
+        nvs_close(memory_handle);
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = settings_timer_callback,
+        .name = "settings",
+    };
+    err = esp_timer_create(&timer_args, &settings_timer);
+    if (err != ESP_OK) {
+        printf("Error - esp_timer_create(): %s\n", esp_err_to_name(err));
+    }
+
+    err = esp_register_shutdown_handler(flush_settings);
+    if (err != ESP_OK) {
+        printf("Error - esp_register_shutdown_handler(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/************************ RESPONSE WRITER ************************/
+
+/**
+ * @brief Function for sending chunk of response writer as http chunk.
+ * 
+ * @param ctx request
+ * @param data data, NULL for terminating chunk
+ * @param len length of data
+ * 
+ * @return esp_err_t esp state
+ */
+esp_err_t writer_send_chunk(void *ctx, const char *data, size_t len) {
+    esp_err_t result = httpd_resp_send_chunk(ctx, data, len);
+
+    if (result != ESP_OK) {
+        printf("Error - writer_send_chunk - httpd_resp_send_chunk(): %s\n", esp_err_to_name(result));
+    } else {
+        METRICS_COUNT(METRICS_COUNTER_BYTES_SENT, len);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Function for initialization of response writer.
+ *        Response is sent in chunks from fixed buffer, nothing is allocated.
+ * 
+ * @param writer writer
+ * @param req request
+ */
+void writer_init(response_writer_t *writer, httpd_req_t *req) {
+    writer_open(writer, writer_send_chunk, req);
+}
+
+/**
+ * @brief Function for getting response format from "format" query parameter.
+ * 
+ * @param req request
+ * 
+ * @return uint8_t response format, json if parameter is missing
+ */
+uint8_t get_response_format(httpd_req_t *req) {
+    char query[64];
+    char format[8];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "format", format, sizeof(format)) != ESP_OK) {
+        return RESPONSE_FORMAT_JSON;
+    }
+
+    if (strcmp(format, "csv") == 0) {
+        return RESPONSE_FORMAT_CSV;
+    } else if (strcmp(format, "bin") == 0) {
+        return RESPONSE_FORMAT_BINARY;
+    }
+
+    return RESPONSE_FORMAT_JSON;
+}
+
+/**
+ * @brief Function for getting channel from "channel" query parameter.
+ * 
+ * @param req request
+ * 
+ * @return int index of channel, 0 if parameter is missing, -1 if channel does not exist
+ */
+int get_query_channel(httpd_req_t *req) {
+    char query[128];
+    char value[4];
+    char *end;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "channel", value, sizeof(value)) != ESP_OK) {
+        return 0;
+    }
+
+    long channel = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || channel < 0 || channel >= CHANNEL_COUNT) {
+        return -1;
+    }
+
+    return channel;
+}
+
+/**
+ * @brief Function for writing samples of one channel to response in requested format.
+ *        Json keeps strings of time and temperature used by web page, csv has one sample per line
+ *        and binary format has packed little-endian uint32_t timestamp and int16_t centi-degrees.
+ *        Samples without value of channel are skipped.
+ * 
+ * @param writer writer
+ * @param samples samples
+ * @param count count of samples
+ * @param format response format
+ * @param channel index of channel
+ */
+void write_samples(response_writer_t *writer, const sample_t *samples, uint16_t count, uint8_t format, uint8_t channel) {
+    char time_string[32];
+    uint16_t written = 0;
+
+    if (format == RESPONSE_FORMAT_JSON) {
+        writer_printf(writer, "{\"temperature\":[");
+    } else if (format == RESPONSE_FORMAT_CSV) {
+        writer_printf(writer, "time,temperature\n");
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t timestamp = (uint32_t)(samples[i].time_us / 1000000);
+        int16_t value = samples[i].temperature[channel];
+        if (value == TEMPERATURE_INVALID) {
+            continue;
+        }
+
+        if (format == RESPONSE_FORMAT_BINARY) {
+            uint8_t record[6] = {
+                timestamp, timestamp >> 8, timestamp >> 16, timestamp >> 24,
+                (uint16_t)value, (uint16_t)value >> 8,
+            };
+            writer_write(writer, record, sizeof(record));
+            continue;
+        }
+
+        format_time(timestamp, time_string, sizeof(time_string));
+        if (format == RESPONSE_FORMAT_CSV) {
+            writer_printf(writer, "%.19s,", time_string);
+            writer_centi(writer, value);
+            writer_printf(writer, "\n");
+        } else {
+            writer_printf(writer, "%s\"%s", written > 0 ? "," : "", time_string);
+            writer_centi(writer, value);
+            writer_printf(writer, "\"");
+        }
+        ++written;
+    }
+
+    if (format == RESPONSE_FORMAT_JSON) {
+        writer_printf(writer, "]}");
+    }
+}
+
+/**
+ * @brief Function for setting content type of response format.
+ * 
+ * @param req request
+ * @param format response format
+ */
+void set_response_type(httpd_req_t *req, uint8_t format) {
+    const char *type = "application/json";
+    if (format == RESPONSE_FORMAT_CSV) {
+        type = "text/csv";
+    } else if (format == RESPONSE_FORMAT_BINARY) {
+        type = "application/octet-stream";
+    }
+
+    err = httpd_resp_set_type(req, type);
+    if (err != ESP_OK) {
+        printf("Error - httpd_resp_set_type(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/************************ WIFI ACCESS POINT ************************/
+
+/**
+ * @brief Function for handling get root request.
+ * 
+ * @param req request
+ * 
+ * @return esp_err_t esp state
+ */
+esp_err_t get_root_handler(httpd_req_t *req) {
+    char etag[sizeof(DASHBOARD_ETAG)] = {'\0'};
+
+    // page did not change since client cached it
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", etag, sizeof(etag)) == ESP_OK && strcmp(etag, DASHBOARD_ETAG) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_set_hdr(req, "ETag", DASHBOARD_ETAG);
+        err = httpd_resp_send(req, NULL, 0);
+        if (err != ESP_OK) {
+            printf("Error - get_root_handler - httpd_resp_send(): %s\n", esp_err_to_name(err));
+        }
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "ETag", DASHBOARD_ETAG);
+
+    // page is sent directly from flash
+    err = httpd_resp_send(req, (const char *)dashboard_html_gz, DASHBOARD_SIZE);
+    if (err != ESP_OK) {
+        printf("Error - get_root_handler - httpd_resp_send(): %s\n", esp_err_to_name(err));
+    } else {
+        METRICS_COUNT(METRICS_COUNTER_BYTES_SENT, DASHBOARD_SIZE);
+    }
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling get temperature request.
+ *        Query parameter channel selects channel, first channel is returned by default.
+ * 
+ * @param req request
+ * 
+ * @return esp_err_t esp state
+ */
+static esp_err_t get_temperature_handler(httpd_req_t *req) {
+    char response[16];
+    int channel = get_query_channel(req);
+
+    if (channel < 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+        return ESP_OK;
+    }
+
+    sample_t sample = read_live_sample();
+    if (sample.temperature[channel] == TEMPERATURE_INVALID) {
+        snprintf(response, sizeof(response), "null");
+    } else {
+        snprintf(response, sizeof(response), "%.2f", sample.temperature[channel] / 100.0);
+    }
+    err = httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
+    if (err != ESP_OK) {
+        printf("Error - get_temperature_handler - httpd_resp_send(): %s\n", esp_err_to_name(err));
+    } else {
+        METRICS_COUNT(METRICS_COUNTER_BYTES_SENT, strlen(response));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling get last 10 temperatures request.
+ *        Query parameter channel selects channel, first channel is returned by default.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t get_last_10_temperatures_handler(httpd_req_t *req) {
+    sample_t samples[HISTORY_SIZE];
+    int channel = get_query_channel(req);
+
+    if (channel < 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+        return ESP_OK;
+    }
+
+    uint16_t count = history_copy(samples, NULL);
+    uint8_t format = get_response_format(req);
+
+    for (uint16_t i = 0; i < count; i++) {
+        samples[i].time_us = resolve_time_us(samples[i].time_us);
+    }
+    response_writer_t writer;
+
+    set_response_type(req, format);
+
+    writer_init(&writer, req);
+    write_samples(&writer, samples, count, format, channel);
+    err = writer_finish(&writer);
+    if (err != ESP_OK) {
+        printf("Error - get_last_10_temperatures_handler - writer_finish(): %s\n", esp_err_to_name(err));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for getting unsigned number from query parameter.
+ * 
+ * @param query query string
+ * @param key parameter name
+ * @param value default value, returned if parameter is missing
+ * 
+ * @return uint32_t value of parameter
+ */
+uint32_t query_get_u32(const char *query, const char *key, uint32_t value) {
+    char buffer[16];
+
+    if (query != NULL && httpd_query_key_value(query, key, buffer, sizeof(buffer)) == ESP_OK) {
+        value = strtoul(buffer, NULL, 10);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Function for writing current bucket of history query.
+ * 
+ * @param query history query
+ */
+void history_write_bucket(history_query_t *query) {
+    response_writer_t *writer = query->writer;
+    int32_t average = query->bucket_sum / query->bucket_count;
+    uint16_t count = query->bucket_count > UINT16_MAX ? UINT16_MAX : query->bucket_count; // binary bucket has 16 bits of count
+
+    if (query->format == RESPONSE_FORMAT_BINARY) {
+        uint8_t bucket[12] = {
+            query->bucket_start, query->bucket_start >> 8, query->bucket_start >> 16, query->bucket_start >> 24,
+            (uint16_t)query->bucket_min, (uint16_t)query->bucket_min >> 8,
+            (uint16_t)query->bucket_max, (uint16_t)query->bucket_max >> 8,
+            (uint16_t)average, (uint16_t)average >> 8,
+            count, count >> 8,
+        };
+        writer_write(writer, bucket, sizeof(bucket));
+    } else {
+        writer_printf(writer, query->format == RESPONSE_FORMAT_CSV ? "%s%lu," : "%s[%lu,", query->count > 0 && query->format == RESPONSE_FORMAT_JSON ? "," : "", (unsigned long)query->bucket_start);
+        writer_centi(writer, query->bucket_min);
+        writer_printf(writer, ",");
+        writer_centi(writer, query->bucket_max);
+        writer_printf(writer, ",");
+        writer_centi(writer, average);
+        writer_printf(writer, query->format == RESPONSE_FORMAT_CSV ? ",%lu\n" : ",%lu]", (unsigned long)query->bucket_count);
+    }
+
+    ++query->count;
+    query->bucket_count = 0;
+}
+
+/**
+ * @brief Function for adding samples to bucket of history query, full bucket is written first.
+ * 
+ * @param query history query
+ * @param timestamp timestamp of samples
+ * @param min minimum of samples
+ * @param max maximum of samples
+ * @param sum sum of samples
+ * @param count count of samples
+ * 
+ * @return bool false when query is finished
+ */
+bool history_add(history_query_t *query, uint32_t timestamp, int16_t min, int16_t max, int64_t sum, uint32_t count) {
+    uint32_t bucket_start = timestamp - timestamp % query->step;
+    if (query->bucket_count > 0 && bucket_start != query->bucket_start) {
+        history_write_bucket(query);
+        if (query->count >= query->limit) {
+            return false;
+        }
+    }
+
+    if (query->bucket_count == 0) {
+        query->bucket_start = bucket_start;
+        query->bucket_min = min;
+        query->bucket_max = max;
+        query->bucket_sum = 0;
+    }
+
+    if (min < query->bucket_min) {
+        query->bucket_min = min;
+    }
+    if (max > query->bucket_max) {
+        query->bucket_max = max;
+    }
+    query->bucket_sum += sum;
+    query->bucket_count += count;
+
+    return true;
+}
+
+/**
+ * @brief Record visitor of history query, writes record or adds it to bucket.
+ * 
+ * @param record record
+ * @param ctx history query
+ * 
+ * @return bool false when query is finished
+ */
+bool history_visit_record(const log_record_t *record, void *ctx) {
+    history_query_t *query = ctx;
+
+    if (record->timestamp > query->to || query->count >= query->limit || query->writer->err != ESP_OK) {
+        return false;
+    }
+
+    if (record->channel != query->channel) {
+        return true;
+    }
+
+    if (query->step == 0) {
+        if (query->format == RESPONSE_FORMAT_BINARY) {
+            uint8_t packed[6] = {
+                record->timestamp, record->timestamp >> 8, record->timestamp >> 16, record->timestamp >> 24,
+                (uint16_t)record->temperature, (uint16_t)record->temperature >> 8,
+            };
+            writer_write(query->writer, packed, sizeof(packed));
+        } else {
+            writer_printf(query->writer, query->format == RESPONSE_FORMAT_CSV ? "%s%lu," : "%s[%lu,", query->count > 0 && query->format == RESPONSE_FORMAT_JSON ? "," : "", (unsigned long)record->timestamp);
+            writer_centi(query->writer, record->temperature);
+            writer_printf(query->writer, query->format == RESPONSE_FORMAT_CSV ? "\n" : "]");
+        }
+        ++query->count;
+        return true;
+    }
+
+    return history_add(query, record->timestamp, record->temperature, record->temperature, record->temperature, 1);
+}
+
+/**
+ * @brief Rollup visitor of history query, adds period of rollup tier to bucket.
+ *        Step of query is multiple of period of tier, so every period falls into one bucket.
+ * 
+ * @param record rollup record
+ * @param ctx history query
+ * 
+ * @return bool false when query is finished
+ */
+bool history_visit_rollup(const rollup_record_t *record, void *ctx) {
+    history_query_t *query = ctx;
+
+    if (record->timestamp > query->to || query->count >= query->limit || query->writer->err != ESP_OK) {
+        return false;
+    }
+
+    if (record->channel != query->channel) {
+        return true;
+    }
+
+    return history_add(query, record->timestamp, record->min, record->max, (int64_t)record->average * record->count, record->count);
+}
+
+/**
+ * @brief Function for handling history request.
+ *        Query parameters: from and to timestamps in seconds, limit of returned rows,
+ *        step in seconds for min/max/avg buckets, channel and format (json, csv, bin).
+ *        Buckets are built from coarsest rollup tier whose period divides step, raw records are scanned otherwise,
+ *        resolution reports period of used tier, 0 for raw records.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t get_history_handler(httpd_req_t *req) {
+    char query_string[128];
+    const char *query_pointer = NULL;
+    response_writer_t writer;
+    int channel = get_query_channel(req);
+
+    if (channel < 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+        return ESP_OK;
+    }
+
+    if (httpd_req_get_url_query_str(req, query_string, sizeof(query_string)) == ESP_OK) {
+        query_pointer = query_string;
+    }
+
+    history_query_t query = {
+        .writer = &writer,
+        .format = get_response_format(req),
+        .to = query_get_u32(query_pointer, "to", UINT32_MAX - 1),
+        .step = query_get_u32(query_pointer, "step", 0),
+        .limit = query_get_u32(query_pointer, "limit", HISTORY_LIMIT_DEFAULT),
+        .channel = channel,
+    };
+    uint32_t from = query_get_u32(query_pointer, "from", 0);
+
+    if (query.limit > HISTORY_LIMIT_MAX) {
+        query.limit = HISTORY_LIMIT_MAX;
+    }
+
+    // coarsest source whose period divides step and which reaches back to from,
+    // or as far back as any source when none reaches from
+    int8_t tier = -1;
+    if (query.step > 0) {
+        uint32_t oldest[ROLLUP_TIERS];
+        uint32_t target = log_oldest_timestamp();
+
+        for (uint8_t t = 0; t < ROLLUP_TIERS; t++) {
+            oldest[t] = query.step % rollup_tiers[t].period == 0 ? rollup_oldest_timestamp(t) : UINT32_MAX;
+            if (oldest[t] < target) {
+                target = oldest[t];
+            }
+        }
+        if (target < from) {
+            target = from;
+        }
+
+        for (int8_t t = ROLLUP_TIERS - 1; t >= 0 && tier < 0; t--) {
+            if (query.step % rollup_tiers[t].period == 0 && oldest[t] <= target) {
+                tier = t;
+            }
+        }
+    }
+
+    set_response_type(req, query.format);
+    writer_init(&writer, req);
+
+    if (query.format == RESPONSE_FORMAT_JSON) {
+        writer_printf(&writer, "{\"channel\":%u,\"from\":%lu,\"to\":%lu,\"step\":%lu,\"resolution\":%lu,\"%s\":[",
+                      query.channel, (unsigned long)from, (unsigned long)query.to, (unsigned long)query.step,
+                      (unsigned long)(tier < 0 ? 0 : rollup_tiers[tier].period), query.step == 0 ? "samples" : "buckets");
+    } else if (query.format == RESPONSE_FORMAT_CSV) {
+        writer_printf(&writer, query.step == 0 ? "time,temperature\n" : "time,min,max,avg,count\n");
+    }
+
+    if (tier < 0) {
+        log_visit_from(from, history_visit_record, &query);
+    } else {
+        rollup_visit_from(tier, from, history_visit_rollup, &query);
+    }
+    if (query.bucket_count > 0 && query.count < query.limit) {
+        history_write_bucket(&query);
+    }
+
+    if (query.format == RESPONSE_FORMAT_JSON) {
+        writer_printf(&writer, "]}");
+    }
+
+    err = writer_finish(&writer);
+    if (err != ESP_OK) {
+        printf("Error - get_history_handler - writer_finish(): %s\n", esp_err_to_name(err));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling statistics request.
+ *        Every channel has moving average and min, max, mean and variance of every window.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t get_stats_handler(httpd_req_t *req) {
+    response_writer_t writer;
+    stats_summary_t summary;
+
+    set_response_type(req, RESPONSE_FORMAT_JSON);
+    writer_init(&writer, req);
+
+    writer_printf(&writer, "{\"channels\":[");
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        writer_printf(&writer, "%s{\"channel\":%u,\"windows\":[", channel > 0 ? "," : "", channel);
+
+        double ewma = NAN;
+        for (uint8_t window = 0; window < STATS_WINDOWS; window++) {
+            ewma = get_stats(channel, window, &summary);
+
+            writer_printf(&writer, "%s{\"window\":%lu,\"count\":%lu", window > 0 ? "," : "",
+                          (unsigned long)stats_window_s[window], (unsigned long)summary.count);
+            if (summary.count > 0) {
+                writer_printf(&writer, ",\"min\":");
+                writer_centi(&writer, summary.min);
+                writer_printf(&writer, ",\"max\":");
+                writer_centi(&writer, summary.max);
+                writer_printf(&writer, ",\"mean\":");
+                writer_centi(&writer, lround(summary.mean * 100.0));
+                writer_printf(&writer, ",\"variance\":");
+                writer_centi(&writer, lround(summary.variance * 100.0));
+            }
+            writer_printf(&writer, "}");
+        }
+
+        writer_printf(&writer, "],\"ewma\":");
+        if (isnan(ewma)) {
+            writer_printf(&writer, "null}");
+        } else {
+            writer_centi(&writer, lround(ewma * 100.0));
+            writer_printf(&writer, "}");
+        }
+    }
+    writer_printf(&writer, "]}");
+
+    err = writer_finish(&writer);
+    if (err != ESP_OK) {
+        printf("Error - get_stats_handler - writer_finish(): %s\n", esp_err_to_name(err));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling get channels request, lists channel table with last temperatures.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t get_channels_handler(httpd_req_t *req) {
+    response_writer_t writer;
+    channel_t config[CHANNEL_COUNT];
+    sample_t sample = read_live_sample();
+
+    read_channels(config, NULL);
+
+    set_response_type(req, RESPONSE_FORMAT_JSON);
+    writer_init(&writer, req);
+
+    writer_printf(&writer, "{\"channels\":[");
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        writer_printf(&writer, "%s{\"channel\":%u,\"gpio\":%u,\"temperature\":", channel > 0 ? "," : "", channel, config[channel].gpio);
+        if (sample.temperature[channel] == TEMPERATURE_INVALID) {
+            writer_printf(&writer, "null");
+        } else {
+            writer_centi(&writer, sample.temperature[channel]);
+        }
+
+        writer_printf(&writer, ",\"threshold\":");
+        if (config[channel].threshold == THRESHOLD_DEFAULT_VALUE) {
+            writer_printf(&writer, "null");
+        } else {
+            writer_centi(&writer, lround(config[channel].threshold * 100.0));
+        }
+        writer_printf(&writer, ",\"overcome\":%s}", config[channel].threshold_overcome ? "true" : "false");
+    }
+    writer_printf(&writer, "]}");
+
+    err = writer_finish(&writer);
+    if (err != ESP_OK) {
+        printf("Error - get_channels_handler - writer_finish(): %s\n", esp_err_to_name(err));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling snapshot request, sends snapshot_t.
+ *        Etag is sequence number of last sample, so unchanged polls get 304 without body.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t get_snapshot_handler(httpd_req_t *req) {
+    sample_t samples[HISTORY_SIZE];
+    snapshot_t snapshot = {0};
+    stats_summary_t summary;
+    channel_t config[CHANNEL_COUNT];
+    char etag[16];
+    char request_etag[16] = {'\0'};
+    uint32_t sequence;
+
+    uint16_t count = history_copy(samples, &sequence);
+    snprintf(etag, sizeof(etag), "\"%lu\"", (unsigned long)sequence);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    // no new sample since last poll
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", request_etag, sizeof(request_etag)) == ESP_OK && strcmp(request_etag, etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        err = httpd_resp_send(req, NULL, 0);
+        if (err != ESP_OK) {
+            printf("Error - get_snapshot_handler - httpd_resp_send(): %s\n", esp_err_to_name(err));
+        }
+        return ESP_OK;
+    }
+
+    snapshot.version = SNAPSHOT_VERSION;
+    snapshot.channel_count = CHANNEL_COUNT;
+    snapshot.window_count = STATS_WINDOWS;
+    snapshot.sample_count = count;
+    snapshot.sequence = sequence;
+    snapshot.flags = threshold_overcome ? SNAPSHOT_THRESHOLD_OVERCOME : 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        snapshot.samples[i].timestamp = (uint32_t)(resolve_time_us(samples[i].time_us) / 1000000);
+        memcpy(snapshot.samples[i].temperature, samples[i].temperature, sizeof(samples[i].temperature));
+    }
+
+    if (count > 0) {
+        snapshot.timestamp = snapshot.samples[0].timestamp;
+        if (snapshot.timestamp >= TIME_VALID_EPOCH) {
+            snapshot.flags |= SNAPSHOT_TIME_VALID;
+        }
+    }
+
+    read_channels(config, NULL);
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        snapshot_channel_t *state = &snapshot.channels[channel];
+        double ewma = NAN;
+
+        state->temperature = count > 0 ? samples[0].temperature[channel] : TEMPERATURE_INVALID;
+        state->threshold = config[channel].threshold == THRESHOLD_DEFAULT_VALUE ? TEMPERATURE_INVALID : lround(config[channel].threshold * 100.0);
+        state->overcome = config[channel].threshold_overcome;
+
+        for (uint8_t window = 0; window < STATS_WINDOWS; window++) {
+            ewma = get_stats(channel, window, &summary);
+
+            state->windows[window].count = summary.count;
+            state->windows[window].min = summary.count > 0 ? summary.min : TEMPERATURE_INVALID;
+            state->windows[window].max = summary.count > 0 ? summary.max : TEMPERATURE_INVALID;
+            state->windows[window].mean = summary.count > 0 ? lround(summary.mean * 100.0) : TEMPERATURE_INVALID;
+            state->windows[window].variance = summary.count > 0 ? lround(summary.variance * 100.0) : 0;
+        }
+        state->ewma = isnan(ewma) ? TEMPERATURE_INVALID : lround(ewma * 100.0);
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    err = httpd_resp_send(req, (const char *)&snapshot, sizeof(snapshot));
+    if (err != ESP_OK) {
+        printf("Error - get_snapshot_handler - httpd_resp_send(): %s\n", esp_err_to_name(err));
+    } else {
+        METRICS_COUNT(METRICS_COUNTER_BYTES_SENT, sizeof(snapshot));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for writing settings as json, password is only reported as set.
+ * 
+ * @param req request
+ * 
+ * @return esp_err_t esp state
+ */
+esp_err_t send_settings(httpd_req_t *req) {
+    response_writer_t writer;
+    channel_t config[CHANNEL_COUNT];
+    double hysteresis;
+
+    read_channels(config, &hysteresis);
+    set_response_type(req, RESPONSE_FORMAT_JSON);
+    writer_init(&writer, req);
+
+    writer_printf(&writer, "{\"channels\":[");
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        writer_printf(&writer, "%s{\"channel\":%u,\"threshold\":", channel > 0 ? "," : "", channel);
+        if (config[channel].threshold == THRESHOLD_DEFAULT_VALUE) {
+            writer_printf(&writer, "null");
+        } else {
+            writer_centi(&writer, lround(config[channel].threshold * 100.0));
+        }
+        writer_printf(&writer, ",\"gain\":");
+        writer_fixed(&writer, llround(config[channel].gain * 1000000.0), 6);
+        writer_printf(&writer, ",\"offset\":");
+        writer_centi(&writer, lround(config[channel].offset * 100.0));
+        writer_printf(&writer, "}");
+    }
+
+    writer_printf(&writer, "],\"hysteresis\":");
+    writer_centi(&writer, lround(hysteresis * 100.0));
+    writer_printf(&writer, ",\"input\":\"%s\",\"period\":%lu,\"adaptive\":%s,\"min\":%lu,\"max\":%lu,\"current\":%lu",
+                  threshold_input == THRESHOLD_INPUT_EWMA ? "ewma" : "temperature", (unsigned long)sample_period_ms,
+                  adaptive_sampling ? "true" : "false", (unsigned long)adaptive_period_min_ms, (unsigned long)adaptive_period_max_ms,
+                  (unsigned long)current_period_ms);
+    writer_printf(&writer, ",\"ssid\":");
+    writer_json_string(&writer, wifi_sta_ssid);
+    writer_printf(&writer, ",\"password_set\":%s,\"ntp\":", strlen(wifi_sta_password) > 0 ? "true" : "false");
+    writer_json_string(&writer, ntp_server);
+    writer_printf(&writer, ",\"uplink_url\":");
+    writer_json_string(&writer, uplink_url);
+    writer_printf(&writer, ",\"uplink_interval\":%lu,\"batch\":%u,\"commit_interval\":%lu", (unsigned long)uplink_interval_ms,
+                  log_batch_size, (unsigned long)log_commit_interval_ms);
+    writer_printf(&writer, ",\"conversion\":\"%s\",\"filter\":\"%s\",\"rate\":%lu,\"low_power\":%s}", conversion_mode_names[conversion_mode],
+                  adc_filter_names[adc_filter], (unsigned long)adc_sample_rate_hz, low_power_mode ? "true" : "false");
+
+    return writer_finish(&writer);
+}
+
+/**
+ * @brief Function for parsing number of field.
+ * 
+ * @param value value of field
+ * @param number output number
+ * 
+ * @return bool true if whole value is finite number
+ */
+bool parse_double(const char *value, double *number) {
+    char *end;
+
+    double result = strtod(value, &end);
+    if (end == value || *end != '\0' || !isfinite(result)) {
+        return false;
+    }
+
+    *number = result;
+    return true;
+}
+
+/**
+ * @brief Function for parsing unsigned integer of field.
+ * 
+ * @param value value of field
+ * @param number output number
+ * 
+ * @return bool true if whole value is decimal number which fits 32 bits
+ */
+bool parse_u32(const char *value, uint32_t *number) {
+    char *end;
+
+    if (value[0] < '0' || value[0] > '9') {
+        return false;
+    }
+
+    unsigned long long result = strtoull(value, &end, 10);
+    if (*end != '\0' || result > UINT32_MAX) {
+        return false;
+    }
+
+    *number = result;
+    return true;
+}
+
+/**
+ * @brief Function for parsing flag of field.
+ * 
+ * @param value value of field, 1, 0, true or false
+ * @param flag output flag
+ * 
+ * @return bool true if value is flag
+ */
+bool parse_flag(const char *value, bool *flag) {
+    if (strcmp(value, "1") == 0 || strcmp(value, "true") == 0) {
+        *flag = true;
+    } else if (strcmp(value, "0") == 0 || strcmp(value, "false") == 0) {
+        *flag = false;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Function for copying string of field.
+ * 
+ * @param value value of field
+ * @param target output string
+ * @param size size of target
+ * 
+ * @return bool true if value fits target
+ */
+bool parse_string(const char *value, char *target, size_t size) {
+    if (strlen(value) >= size) {
+        return false;
+    }
+
+    strcpy(target, value);
+    return true;
+}
+
+/**
+ * @brief Function for applying one field of request to settings update, called by body parser.
+ *        Keys threshold, gain and offset are of channel selected by preceding key channel,
+ *        or of channel given by suffix, e.g. threshold.1. Threshold null disables threshold,
+ *        conversion exact selects quadratic formula instead of lookup table for validation.
+ * 
+ * @param ctx settings update
+ * @param key key of field
+ * @param value value of field
+ * 
+ * @return bool true if key is known and value is valid
+ */
+bool settings_field(void *ctx, const char *key, const char *value) {
+    settings_update_t *update = ctx;
+    settings_t *settings = &update->settings;
+    char name[PARSER_KEY_MAX + 1];
+    uint32_t channel = update->channel;
+    const char *suffix = strchr(key, '.');
+
+    strlcpy(name, key, sizeof(name));
+    if (suffix != NULL) {
+        name[suffix - key] = '\0';
+        if (!parse_u32(suffix + 1, &channel) || channel >= CHANNEL_COUNT ||
+            (strcmp(name, "threshold") != 0 && strcmp(name, "gain") != 0 && strcmp(name, "offset") != 0)) {
+            return false;
+        }
+    }
+
+    if (strcmp(name, "channel") == 0) {
+        if (!parse_u32(value, &channel) || channel >= CHANNEL_COUNT) {
+            return false;
+        }
+        update->channel = channel;
+        return true;
+    }
+
+    if (strcmp(name, "threshold") == 0) {
+        if (strcmp(value, "null") == 0) {
+            settings->threshold[channel] = THRESHOLD_DEFAULT_VALUE;
+            return true;
+        }
+        return parse_double(value, &settings->threshold[channel]);
+    }
+    if (strcmp(name, "gain") == 0) {
+        return parse_double(value, &settings->gain[channel]);
+    }
+    if (strcmp(name, "offset") == 0) {
+        return parse_double(value, &settings->offset[channel]);
+    }
+    if (strcmp(name, "hysteresis") == 0) {
+        return parse_double(value, &settings->hysteresis);
+    }
+
+    if (strcmp(name, "input") == 0) {
+        if (strcmp(value, "temperature") == 0) {
+            settings->threshold_input = THRESHOLD_INPUT_TEMPERATURE;
+        } else if (strcmp(value, "ewma") == 0) {
+            settings->threshold_input = THRESHOLD_INPUT_EWMA;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    if (strcmp(name, "conversion") == 0) {
+        for (uint8_t mode = CONVERSION_EXACT; mode <= CONVERSION_LUT_INTERPOLATED; mode++) {
+            if (strcmp(value, conversion_mode_names[mode]) == 0) {
+                settings->conversion_mode = mode;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (strcmp(name, "filter") == 0) {
+        for (uint8_t filter = ADC_FILTER_AVERAGE; filter <= ADC_FILTER_MEDIAN; filter++) {
+            if (strcmp(value, adc_filter_names[filter]) == 0) {
+                settings->adc_filter = filter;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (strcmp(name, "rate") == 0) {
+        return parse_u32(value, &settings->adc_sample_rate_hz);
+    }
+
+    if (strcmp(name, "adaptive") == 0) {
+        return parse_flag(value, &settings->adaptive_sampling);
+    }
+    if (strcmp(name, "low_power") == 0) {
+        return parse_flag(value, &settings->low_power_mode);
+    }
+    if (strcmp(name, "period") == 0) {
+        return parse_u32(value, &settings->sample_period_ms);
+    }
+    if (strcmp(name, "min") == 0) {
+        return parse_u32(value, &settings->adaptive_period_min_ms);
+    }
+    if (strcmp(name, "max") == 0) {
+        return parse_u32(value, &settings->adaptive_period_max_ms);
+    }
+    if (strcmp(name, "uplink_interval") == 0) {
+        return parse_u32(value, &settings->uplink_interval_ms);
+    }
+    if (strcmp(name, "batch") == 0) {
+        uint32_t size;
+        if (!parse_u32(value, &size) || size > UINT16_MAX) {
+            return false;
+        }
+        settings->log_batch_size = size;
+        return true;
+    }
+    if (strcmp(name, "commit_interval") == 0) {
+        return parse_u32(value, &settings->log_commit_interval_ms);
+    }
+
+    if (strcmp(name, "ssid") == 0) {
+        return parse_string(value, settings->wifi_ssid, sizeof(settings->wifi_ssid));
+    }
+    if (strcmp(name, "password") == 0) {
+        return parse_string(value, settings->wifi_password, sizeof(settings->wifi_password));
+    }
+    if (strcmp(name, "ntp") == 0) {
+        return parse_string(value, settings->ntp_server, sizeof(settings->ntp_server));
+    }
+    if (strcmp(name, "uplink_url") == 0) {
+        return parse_string(value, settings->uplink_url, sizeof(settings->uplink_url));
+    }
+
+    return false;
+}
+
+/**
+ * @brief Function for sending error of body parser.
+ * 
+ * @param req request
+ * @param parser parser which failed
+ */
+void send_parser_error(httpd_req_t *req, const body_parser_t *parser) {
+    char message[PARSER_KEY_MAX + 24];
+
+    switch (parser->error) {
+        case PARSER_ERROR_TOO_LONG:
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Field too long");
+            break;
+
+        case PARSER_ERROR_FIELD:
+            snprintf(message, sizeof(message), "Invalid field %s", parser->key);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, message);
+            break;
+
+        default:
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed request");
+            break;
+    }
+}
+
+/**
+ * @brief Function for receiving fields of write request from its query and body.
+ *        Query is parsed as form, body as form or json by its content type. Body is received in
+ *        chunks of REQUEST_CHUNK_SIZE, so no field is ever copied into buffer of whole body.
+ *        Error response is sent when fields are not received.
+ * 
+ * @param req request
+ * @param field callback called for every field
+ * @param ctx context of callback
+ * 
+ * @return esp_err_t ESP_OK if all fields were received, ESP_ERR_INVALID_ARG if error was sent, ESP_FAIL if session should be closed
+ */
+esp_err_t receive_fields(httpd_req_t *req, parser_field_t field, void *ctx) {
+    body_parser_t parser;
+    char chunk[REQUEST_CHUNK_SIZE];
+    char type[48];
+    size_t received = 0;
+    uint8_t timeouts = 0;
+    uint8_t format = PARSER_FORMAT_FORM;
+
+    // query is parsed first, so body can override it
+    size_t query_len = httpd_req_get_url_query_len(req);
+    if (query_len > 0) {
+        char query[128];
+        if (query_len >= sizeof(query) || httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+            httpd_resp_send_err(req, HTTPD_414_URI_TOO_LONG, "Query too long");
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        parser_init(&parser, PARSER_FORMAT_FORM, field, ctx);
+        parser_feed(&parser, query, query_len);
+        if (parser_finish(&parser) != PARSER_OK) {
+            send_parser_error(req, &parser);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (req->content_len == 0) {
+        return ESP_OK;
+    }
+
+    if (req->content_len > SETTINGS_BODY_MAX) {
+        // rest of body is not read, session is closed after response
+        httpd_resp_send_err(req, HTTPD_413_CONTENT_TOO_LARGE, "Body too long");
+        return ESP_FAIL;
+    }
+
+    if (httpd_req_get_hdr_value_str(req, "Content-Type", type, sizeof(type)) == ESP_OK) {
+        if (strncmp(type, "application/json", strlen("application/json")) == 0) {
+            format = PARSER_FORMAT_JSON;
+        } else if (strncmp(type, "application/x-www-form-urlencoded", strlen("application/x-www-form-urlencoded")) != 0 &&
+                   strncmp(type, "text/plain", strlen("text/plain")) != 0) {
+            httpd_resp_set_status(req, "415 Unsupported Media Type");
+            httpd_resp_set_type(req, "text/plain");
+            httpd_resp_send(req, "Unsupported content type", HTTPD_RESP_USE_STRLEN);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    parser_init(&parser, format, field, ctx);
+    while (received < req->content_len) {
+        size_t remaining = req->content_len - received;
+        int len = httpd_req_recv(req, chunk, remaining < sizeof(chunk) ? remaining : sizeof(chunk));
+        if (len <= 0) {
+            if (len == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts < REQUEST_RECV_RETRIES) {
+                continue;
+            }
+            if (len == HTTPD_SOCK_ERR_TIMEOUT) {
+                httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, "Body not received");
+            }
+            return ESP_FAIL;
+        }
+        received += len;
+
+        if (parser_feed(&parser, chunk, len) != PARSER_OK) {
+            break; // rest of body is discarded by server
+        }
+    }
+
+    if (parser_finish(&parser) != PARSER_OK) {
+        send_parser_error(req, &parser);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling settings update request, all fields of request are changed together.
+ *        All settings are validated before any is applied, changed settings are written with debounce.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+esp_err_t update_settings(httpd_req_t *req) {
+    settings_update_t update;
+
+    settings_capture(&update.settings);
+    update.channel = 0;
+
+    err = receive_fields(req, settings_field, &update);
+    if (err != ESP_OK) {
+        return err == ESP_FAIL ? ESP_FAIL : ESP_OK;
+    }
+
+    if (!settings_valid(&update.settings)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid settings");
+        return ESP_OK;
+    }
+
+    settings_apply(&update.settings);
+    settings_changed();
+
+    err = send_settings(req);
+    if (err != ESP_OK) {
+        printf("Error - update_settings - send_settings(): %s\n", esp_err_to_name(err));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling set threshold request, body is form or json with threshold.
+ *        Query parameter channel selects channel, threshold of first channel is set by default.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t post_set_threshold_handler(httpd_req_t *req) {
+    return update_settings(req);
+}
+
+/**
+ * @brief Function for handling sampling request, sets schedule of sampling and returns settings.
+ *        Parameters period, adaptive, min and max are optional in query or body, periods are in milliseconds,
+ *        new period is used from next sample.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t post_sampling_handler(httpd_req_t *req) {
+    return update_settings(req);
+}
+
+/**
+ * @brief Function for handling get settings request.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t get_config_handler(httpd_req_t *req) {
+    err = send_settings(req);
+    if (err != ESP_OK) {
+        printf("Error - get_config_handler - send_settings(): %s\n", esp_err_to_name(err));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling put settings request, body is form or json with changed settings.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t put_config_handler(httpd_req_t *req) {
+    return update_settings(req);
+}
+
+/**
+ * @brief Function for writing alert rules with their state and recent notifications as json.
+ *        Limit is in degrees, degrees per minute or seconds by type, value of notification is null without valid value.
+ * 
+ * @param req request
+ * 
+ * @return esp_err_t esp state
+ */
+esp_err_t send_alerts(httpd_req_t *req) {
+    response_writer_t writer;
+    alert_rule_t rules[ALERT_RULES_MAX];
+    bool active[ALERT_RULES_MAX];
+    char event_string[ALERT_EVENT_MAX_SIZE];
+    alert_event_t event;
+    uint32_t sequence = 0;
+
+    portENTER_CRITICAL(&alert_lock);
+    memcpy(rules, alert_rules, sizeof(rules));
+    for (uint8_t i = 0; i < ALERT_RULES_MAX; i++) {
+        active[i] = alert_states[i].active;
+    }
+    if (alert_event_count > ALERT_EVENTS_SIZE) {
+        sequence = alert_event_count - ALERT_EVENTS_SIZE;
+    }
+    portEXIT_CRITICAL(&alert_lock);
+
+    set_response_type(req, RESPONSE_FORMAT_JSON);
+    writer_init(&writer, req);
+
+    writer_printf(&writer, "{\"rules\":[");
+    for (uint8_t i = 0; i < ALERT_RULES_MAX; i++) {
+        writer_printf(&writer, "%s{\"rule\":%u,\"type\":\"%s\",\"channel\":%u,\"limit\":", i > 0 ? "," : "", i,
+                      alert_type_names[rules[i].type], rules[i].channel);
+        writer_centi(&writer, lround(rules[i].limit * 100.0));
+        writer_printf(&writer, ",\"hysteresis\":");
+        writer_centi(&writer, lround(rules[i].hysteresis * 100.0));
+        writer_printf(&writer, ",\"duration\":%lu,\"active\":%s}", (unsigned long)rules[i].duration_s, active[i] ? "true" : "false");
+    }
+
+    writer_printf(&writer, "],\"events\":[");
+    for (uint8_t i = 0; read_alert_event(&sequence, &event); i++, sequence++) {
+        int len = format_alert_event(&event, event_string, sizeof(event_string));
+        writer_printf(&writer, "%s", i > 0 ? "," : "");
+        writer_write(&writer, event_string, len);
+    }
+    writer_printf(&writer, "]}");
+
+    return writer_finish(&writer);
+}
+
+/**
+ * @brief Function for applying one field of request to alert rules, called by body parser.
+ *        Keys type, channel, limit, hysteresis and duration are of rule selected by preceding key rule,
+ *        or of rule given by suffix, e.g. limit.1. Type off disables rule.
+ * 
+ * @param ctx alert update
+ * @param key key of field
+ * @param value value of field
+ * 
+ * @return bool true if key is known and value is valid
+ */
+bool alert_field(void *ctx, const char *key, const char *value) {
+    alert_update_t *update = ctx;
+    char name[PARSER_KEY_MAX + 1];
+    uint32_t index = update->rule;
+    uint32_t number;
+    const char *suffix = strchr(key, '.');
+
+    strlcpy(name, key, sizeof(name));
+    if (suffix != NULL) {
+        name[suffix - key] = '\0';
+        if (!parse_u32(suffix + 1, &index) || index >= ALERT_RULES_MAX || strcmp(name, "rule") == 0) {
+            return false;
+        }
+    }
+
+    if (strcmp(name, "rule") == 0) {
+        if (!parse_u32(value, &index) || index >= ALERT_RULES_MAX) {
+            return false;
+        }
+        update->rule = index;
+        return true;
+    }
+
+    alert_rule_t *rule = &update->rules[index];
+    if (strcmp(name, "type") == 0) {
+        for (uint8_t type = ALERT_OFF; type <= ALERT_STALE; type++) {
+            if (strcmp(value, alert_type_names[type]) == 0) {
+                rule->type = type;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (strcmp(name, "channel") == 0) {
+        if (!parse_u32(value, &number) || number >= CHANNEL_COUNT) {
+            return false;
+        }
+        rule->channel = number;
+        return true;
+    }
+    if (strcmp(name, "limit") == 0) {
+        return parse_double(value, &rule->limit);
+    }
+    if (strcmp(name, "hysteresis") == 0) {
+        return parse_double(value, &rule->hysteresis);
+    }
+    if (strcmp(name, "duration") == 0) {
+        return parse_u32(value, &rule->duration_s);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Function for handling get alerts request.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t get_alerts_handler(httpd_req_t *req) {
+    err = send_alerts(req);
+    if (err != ESP_OK) {
+        printf("Error - get_alerts_handler - send_alerts(): %s\n", esp_err_to_name(err));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling put alerts request, body is form or json with changed fields of rules.
+ *        All rules are validated before any is applied, changed rules start evaluation again and are written with debounce.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t put_alerts_handler(httpd_req_t *req) {
+    alert_update_t update;
+
+    alert_rules_capture(update.rules);
+    update.rule = 0;
+
+    err = receive_fields(req, alert_field, &update);
+    if (err != ESP_OK) {
+        return err == ESP_FAIL ? ESP_FAIL : ESP_OK;
+    }
+
+    for (uint8_t i = 0; i < ALERT_RULES_MAX; i++) {
+        if (!alert_rule_valid(&update.rules[i])) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid alert rule");
+            return ESP_OK;
+        }
+    }
+
+    alert_rules_apply(update.rules);
+    settings_changed();
+
+    err = send_alerts(req);
+    if (err != ESP_OK) {
+        printf("Error - put_alerts_handler - send_alerts(): %s\n", esp_err_to_name(err));
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling websocket requests on /ws.
+ *        Clients only subscribe to live samples, received frames are discarded.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t ws_handler(httpd_req_t *req) {
+    if (req->method == HTTP_GET) { // handshake
+        printf("Websocket client connected: %d\n", httpd_req_to_sockfd(req));
+        return ESP_OK;
+    }
+
+    uint8_t buffer[32];
+    httpd_ws_frame_t frame = {0};
+    frame.payload = buffer;
+
+    err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK) {
+        printf("Error - ws_handler - httpd_ws_recv_frame(): %s\n", esp_err_to_name(err));
+        return err;
+    }
+
+    // clients are not expected to send data, too long frames close the connection
+    if (frame.len > sizeof(buffer)) {
+        printf("Error - ws_handler: frame of %u bytes rejected\n", (unsigned)frame.len);
+        return ESP_FAIL;
+    }
+
+    if (frame.len > 0) {
+        err = httpd_ws_recv_frame(req, &frame, sizeof(buffer));
+        if (err != ESP_OK) {
+            printf("Error - ws_handler - httpd_ws_recv_frame(): %s\n", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for sending text frame to all websocket clients, runs in httpd task.
+ * 
+ * @param payload text of frame
+ * @param len length of text
+ */
+static void ws_send_all(const char *payload, size_t len) {
+    int fds[WS_MAX_CLIENTS];
+    size_t fds_count = WS_MAX_CLIENTS;
+
+    httpd_ws_frame_t frame = {
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)payload,
+        .len = len,
+    };
+
+    if (httpd_get_client_list(server, &fds_count, fds) != ESP_OK) {
+        return;
+    }
+
+    for (size_t i = 0; i < fds_count; i++) {
+        if (httpd_ws_get_fd_info(server, fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+            err = httpd_ws_send_frame_async(server, fds[i], &frame);
+            if (err != ESP_OK) {
+                printf("Error - ws_send_all - httpd_ws_send_frame_async(): %s\n", esp_err_to_name(err));
+            } else {
+                METRICS_COUNT(METRICS_COUNTER_BYTES_SENT, len);
+                // subscribers only receive, so they would be least recently used and purged first
+                httpd_sess_update_lru_counter(server, fds[i]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Function for sending last sample to all websocket clients, runs in httpd task.
+ *        Value v is temperature of first channel, array c has temperatures of all channels.
+ * 
+ * @param arg unused
+ */
+static void ws_broadcast(void *arg) {
+    char time_string[32];
+    char payload[64 + 8 * CHANNEL_COUNT];
+
+    atomic_store(&ws_broadcast_pending, false);
+
+    sample_t sample = read_live_sample();
+    format_time(resolve_time_us(sample.time_us) / 1000000, time_string, sizeof(time_string));
+    int len = snprintf(payload, sizeof(payload), "{\"t\":\"%s\",\"c\":[", time_string);
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (sample.temperature[channel] == TEMPERATURE_INVALID) {
+            len += snprintf(payload + len, sizeof(payload) - len, "%snull", channel > 0 ? "," : "");
+        } else {
+            len += snprintf(payload + len, sizeof(payload) - len, "%s%.2f", channel > 0 ? "," : "", sample.temperature[channel] / 100.0);
+        }
+    }
+
+    if (sample.temperature[0] == TEMPERATURE_INVALID) {
+        len += snprintf(payload + len, sizeof(payload) - len, "],\"v\":null}");
+    } else {
+        len += snprintf(payload + len, sizeof(payload) - len, "],\"v\":%.2f}", sample.temperature[0] / 100.0);
+    }
+
+    ws_send_all(payload, len);
+}
+
+/**
+ * @brief Function for sending new alert notifications to all websocket clients, runs in httpd task.
+ *        Each notification is sent as object alert, notifications overwritten in ring are skipped.
+ * 
+ * @param arg unused
+ */
+static void ws_broadcast_alerts(void *arg) {
+    char payload[16 + ALERT_EVENT_MAX_SIZE];
+    alert_event_t event;
+
+    atomic_store(&ws_alert_pending, false);
+
+    while (read_alert_event(&ws_alert_sent, &event)) {
+        int len = snprintf(payload, sizeof(payload), "{\"alert\":");
+        len += format_alert_event(&event, payload + len, sizeof(payload) - len - 1);
+        payload[len++] = '}';
+        ws_send_all(payload, len);
+        ++ws_alert_sent;
+    }
+}
+
+/**
+ * @brief Function for notifying websocket clients about new sample, called by sampler task.
+ *        Only one broadcast is queued at a time, it always sends the newest sample.
+ */
+void notify_subscribers() {
+    if (server == NULL || atomic_exchange(&ws_broadcast_pending, true)) {
+        return;
+    }
+
+    if (httpd_queue_work(server, ws_broadcast, NULL) != ESP_OK) {
+        atomic_store(&ws_broadcast_pending, false);
+    }
+}
+
+/**
+ * @brief Function for pushing new alert notifications to websocket clients and uplink, called by sampler task.
+ *        Telemetry task is woken, so notification does not wait for next uplink interval.
+ */
+void notify_alerts() {
+    if (telemetry_task_handle != NULL) {
+        xTaskNotifyGive(telemetry_task_handle);
+    }
+
+    if (server == NULL || atomic_exchange(&ws_alert_pending, true)) {
+        return;
+    }
+
+    if (httpd_queue_work(server, ws_broadcast_alerts, NULL) != ESP_OK) {
+        atomic_store(&ws_alert_pending, false);
+    }
+}
+
+#if METRICS_ENABLED
+/**
+ * @brief Function for writing one sample of counter or gauge metric with its help and type.
+ * 
+ * @param writer writer
+ * @param name name of metric
+ * @param type prometheus type of metric
+ * @param help description of metric
+ * @param value value
+ */
+void writer_metric(response_writer_t *writer, const char *name, const char *type, const char *help, unsigned long value) {
+    writer_printf(writer, "# HELP %s %s\n# TYPE %s %s\n%s %lu\n", name, help, name, type, name, value);
+}
+
+/**
+ * @brief Function for writing histogram with one label as prometheus histogram, buckets are cumulative.
+ * 
+ * @param writer writer
+ * @param name name of metric
+ * @param label name of label
+ * @param value value of label
+ * @param source histogram
+ */
+void writer_histogram(response_writer_t *writer, const char *name, const char *label, const char *value, const metrics_histogram_t *source) {
+    metrics_histogram_t histogram = metrics_read(source);
+    uint32_t cumulative = 0;
+
+    for (uint8_t i = 0; i < METRICS_BUCKETS; i++) {
+        cumulative += histogram.buckets[i];
+        if (i < METRICS_BUCKETS - 1) {
+            writer_printf(writer, "%s_bucket{%s=\"%s\",le=\"%lu\"} %lu\n", name, label, value,
+                          (unsigned long)(1024UL << (2 * i)), (unsigned long)cumulative);
+        } else {
+            writer_printf(writer, "%s_bucket{%s=\"%s\",le=\"+Inf\"} %lu\n", name, label, value, (unsigned long)cumulative);
+        }
+    }
+
+    writer_printf(writer, "%s_sum{%s=\"%s\"} %llu\n", name, label, value, (unsigned long long)histogram.sum);
+    writer_printf(writer, "%s_count{%s=\"%s\"} %lu\n", name, label, value, (unsigned long)histogram.count);
+}
+
+/**
+ * @brief Function for handling metrics request in prometheus text format.
+ *        Durations are in cpu cycles, imp_cpu_frequency_hz converts them to seconds.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+static esp_err_t get_metrics_handler(httpd_req_t *req) {
+    response_writer_t writer;
+    const char *task_names[] = {"sampler", "storage", "telemetry", "httpd"};
+    TaskHandle_t tasks[] = {sampler_task_handle, storage_task_handle, telemetry_task_handle, httpd_task_handle};
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    writer_init(&writer, req);
+
+    writer_metric(&writer, "imp_samples_total", "counter", "Count of taken samples.",
+                  atomic_load_explicit(&metrics_counters[METRICS_COUNTER_SAMPLES], memory_order_relaxed));
+    writer_metric(&writer, "imp_dropped_samples_total", "counter", "Count of samples dropped because sample queue was full.", dropped_samples);
+    writer_metric(&writer, "imp_dropped_records_total", "counter", "Count of records dropped because flash writes failed and staging buffer was full.",
+                  dropped_records);
+    writer_metric(&writer, "imp_flash_writes_total", "counter", "Count of blocks written to flash.",
+                  atomic_load_explicit(&metrics_counters[METRICS_COUNTER_FLASH_WRITES], memory_order_relaxed));
+    writer_metric(&writer, "imp_commit_failures_total", "counter", "Count of failed flash writes and nvs commits.",
+                  atomic_load_explicit(&metrics_counters[METRICS_COUNTER_COMMIT_FAILURES], memory_order_relaxed));
+    writer_metric(&writer, "imp_memory_clears_total", "counter", "Count of memory clears.",
+                  atomic_load_explicit(&metrics_counters[METRICS_COUNTER_MEMORY_CLEARS], memory_order_relaxed));
+    writer_metric(&writer, "imp_http_sent_bytes_total", "counter", "Count of bytes sent by web server.",
+                  atomic_load_explicit(&metrics_counters[METRICS_COUNTER_BYTES_SENT], memory_order_relaxed));
+    writer_metric(&writer, "imp_heap_free_bytes", "gauge", "Free heap.", esp_get_free_heap_size());
+    writer_metric(&writer, "imp_heap_min_free_bytes", "gauge", "Lowest free heap since boot.", esp_get_minimum_free_heap_size());
+    writer_metric(&writer, "imp_heap_largest_free_block_bytes", "gauge", "Largest free block of heap, falls when heap fragments.",
+                  heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    writer_metric(&writer, "imp_cpu_frequency_hz", "gauge", "Frequency of cpu cycle counter.", esp_rom_get_cpu_ticks_per_us() * 1000000UL);
+
+    writer_printf(&writer, "# HELP imp_stack_high_water_bytes Lowest free stack of task since start.\n# TYPE imp_stack_high_water_bytes gauge\n");
+    for (uint8_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++) {
+        if (tasks[i] != NULL) {
+            writer_printf(&writer, "imp_stack_high_water_bytes{task=\"%s\"} %lu\n", task_names[i], (unsigned long)uxTaskGetStackHighWaterMark(tasks[i]));
+        }
+    }
+    for (uint8_t i = 0; i < HTTPD_WORKER_COUNT; i++) {
+        if (httpd_worker_handles[i] != NULL) {
+            writer_printf(&writer, "imp_stack_high_water_bytes{task=\"httpd_worker%u\"} %lu\n", i, (unsigned long)uxTaskGetStackHighWaterMark(httpd_worker_handles[i]));
+        }
+    }
+
+    writer_printf(&writer, "# HELP imp_stage_duration_cycles Duration of hot path stage.\n# TYPE imp_stage_duration_cycles histogram\n");
+    for (uint8_t stage = 0; stage < METRICS_STAGES; stage++) {
+        writer_histogram(&writer, "imp_stage_duration_cycles", "stage", metrics_stage_names[stage], &metrics_stages[stage]);
+    }
+
+    // request counter is count of duration histogram
+    writer_printf(&writer, "# HELP imp_http_request_duration_cycles Duration of endpoint handler.\n# TYPE imp_http_request_duration_cycles histogram\n");
+    for (uint8_t uri = 0; uri < METRICS_URIS; uri++) {
+        writer_histogram(&writer, "imp_http_request_duration_cycles", "uri", metrics_uri_names[uri], &metrics_uris[uri]);
+    }
+
+    err = writer_finish(&writer);
+    if (err != ESP_OK) {
+        printf("Error - get_metrics_handler - writer_finish(): %s\n", esp_err_to_name(err));
+    }
+
+    return ESP_OK;
+}
+#endif
+
+/**
+ * @brief Function for running handler of endpoint, measures its duration when metrics are enabled.
+ * 
+ * @param req request, user context is endpoint
+ * @return esp_err_t state of handler
+ */
+esp_err_t endpoint_run(httpd_req_t *req) {
+    const endpoint_t *endpoint = req->user_ctx;
+
+    METRICS_START(start);
+    esp_err_t result = endpoint->handler(req);
+    METRICS_STOP(metrics_uris[endpoint->metrics_uri], start);
+
+    return result;
+}
+
+/**
+ * @brief Function for handing request over to idle worker.
+ *        Request is refused with 503 when all workers are busy, so httpd task never waits.
+ * 
+ * @param req request
+ * @return esp_err_t esp state
+ */
+esp_err_t endpoint_queue(httpd_req_t *req) {
+    httpd_req_t *copy = NULL;
+
+    if (xSemaphoreTake(httpd_workers_ready, 0) != pdTRUE) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        err = httpd_resp_send(req, NULL, 0);
+        if (err != ESP_OK) {
+            printf("Error - endpoint_queue - httpd_resp_send(): %s\n", esp_err_to_name(err));
+        }
+        return ESP_OK;
+    }
+
+    err = httpd_req_async_handler_begin(req, &copy);
+    if (err != ESP_OK) {
+        printf("Error - httpd_req_async_handler_begin(): %s\n", esp_err_to_name(err));
+        xSemaphoreGive(httpd_workers_ready);
+        return ESP_FAIL;
+    }
+
+    // queue has place for every worker, so it is never full when worker was idle
+    xQueueSend(httpd_worker_queue, &copy, 0);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for handling request of every endpoint.
+ *        Endpoints with low priority are handled by worker task, others directly by httpd task.
+ * 
+ * @param req request, user context is endpoint
+ * @return esp_err_t esp state
+ */
+static esp_err_t endpoint_handler(httpd_req_t *req) {
+    const endpoint_t *endpoint = req->user_ctx;
+
+    if (httpd_task_handle == NULL) {
+        httpd_task_handle = xTaskGetCurrentTaskHandle();
+    }
+
+    if (endpoint->priority == ENDPOINT_PRIORITY_LOW && httpd_worker_queue != NULL) {
+        return endpoint_queue(req);
+    }
+
+    return endpoint_run(req);
+}
+
+/**
+ * @brief Worker task, handles asynchronous copies of long requests.
+ * 
+ * @param arg unused
+ */
+void httpd_worker_task(void *arg) {
+    httpd_req_t *req;
+
+    while (1) {
+        xSemaphoreGive(httpd_workers_ready);
+
+        if (xQueueReceive(httpd_worker_queue, &req, portMAX_DELAY) == pdTRUE) {
+            endpoint_run(req);
+
+            err = httpd_req_async_handler_complete(req);
+            if (err != ESP_OK) {
+                printf("Error - httpd_req_async_handler_complete(): %s\n", esp_err_to_name(err));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Function for starting worker tasks of web server, they are kept when server is stopped.
+ */
+void start_httpd_workers() {
+    if (httpd_worker_queue != NULL) {
+        return;
+    }
+
+    httpd_worker_queue = create_queue(HTTPD_WORKER_COUNT, sizeof(httpd_req_t *), STATIC_BUFFER(httpd_worker_queue_storage), STATIC_BUFFER(&httpd_worker_queue_buffer));
+    httpd_workers_ready = create_counting_semaphore(HTTPD_WORKER_COUNT, 0, STATIC_BUFFER(&httpd_workers_ready_buffer));
+    if (httpd_worker_queue == NULL || httpd_workers_ready == NULL) {
+        printf("Error - start_httpd_workers(): queue not created, long requests are handled by httpd task\n");
+        httpd_worker_queue = NULL;
+        return;
+    }
+
+    for (uint8_t i = 0; i < HTTPD_WORKER_COUNT; i++) {
+        if (!create_task(httpd_worker_task, "httpd_worker", HTTPD_WORKER_STACK_SIZE, STATIC_BUFFER(httpd_worker_stacks[i]), STATIC_BUFFER(&httpd_worker_buffers[i]),
+                         HTTPD_WORKER_PRIORITY, &httpd_worker_handles[i], HTTPD_TASK_CORE)) {
+            printf("Error - create_task(): httpd worker task not created\n");
+        }
+    }
+}
+
+/**
+ * @brief Function for registering endpoint, every endpoint is handled by endpoint_handler.
+ * 
+ * @param server server
+ * @param uri endpoint
+ * @param metrics_uri index of endpoint in metrics
+ * @param priority ENDPOINT_PRIORITY_HIGH or ENDPOINT_PRIORITY_LOW, websocket endpoint has to be high
+ */
+void register_endpoint(httpd_handle_t server, httpd_uri_t *uri, uint8_t metrics_uri, uint8_t priority) {
+    if (endpoint_count >= HTTPD_MAX_URI_HANDLERS) {
+        printf("Error - register_endpoint(): endpoint table is full\n");
+        return;
+    }
+
+    endpoint_t *endpoint = &endpoints[endpoint_count++];
+    endpoint->handler = uri->handler;
+    endpoint->metrics_uri = metrics_uri;
+    endpoint->priority = priority;
+
+    uri->handler = endpoint_handler;
+    uri->user_ctx = endpoint;
+
+    err = httpd_register_uri_handler(server, uri);
+    if (err != ESP_OK) {
+        printf("Error - httpd_register_uri_handler(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Function where endpoints are defined.
+ *        Inspired by: https://esp32tutorials.com/esp32-web-server-esp-idf/
+ * 
+ * @return httpd_handle_t server
+ */
+httpd_handle_t define_endpoints() {
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    httpd_handle_t server = NULL;
+
+    config.max_uri_handlers = HTTPD_MAX_URI_HANDLERS;
+    config.task_priority = HTTPD_TASK_PRIORITY;
+    config.core_id = HTTPD_TASK_CORE;
+    config.stack_size = HTTPD_STACK_SIZE;
+    config.max_open_sockets = HTTPD_MAX_OPEN_SOCKETS;
+    config.lru_purge_enable = true; // stale sockets of closed dashboards do not exhaust server, websocket subscribers are kept fresh by ws_send_all
+    config.keep_alive_enable = true;
+    config.keep_alive_idle = HTTPD_KEEP_ALIVE_IDLE_S;
+    config.keep_alive_interval = HTTPD_KEEP_ALIVE_INTERVAL_S;
+    config.keep_alive_count = HTTPD_KEEP_ALIVE_COUNT;
+
+    start_httpd_workers();
+    endpoint_count = 0;
+
+    if (httpd_start(&server, &config) == ESP_OK) {
+        // root
+        httpd_uri_t get_root = {
+            .uri      = "/",
+            .method   = HTTP_GET,
+            .handler  = get_root_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_root, METRICS_URI_ROOT, ENDPOINT_PRIORITY_HIGH);
+
+        // get temperature
+        httpd_uri_t get_temperature = {
+            .uri      = "/get_temperature",
+            .method   = HTTP_GET,
+            .handler  = get_temperature_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_temperature, METRICS_URI_GET_TEMPERATURE, ENDPOINT_PRIORITY_HIGH);
+
+        // set threshold
+        httpd_uri_t set_threshold = {
+            .uri       = "/set_threshold",
+            .method    = HTTP_POST,
+            .handler   = post_set_threshold_handler,
+            .user_ctx  = NULL
+        };
+        register_endpoint(server, &set_threshold, METRICS_URI_SET_THRESHOLD, ENDPOINT_PRIORITY_HIGH);
+
+        // sampling schedule
+        httpd_uri_t sampling = {
+            .uri       = "/sampling",
+            .method    = HTTP_POST,
+            .handler   = post_sampling_handler,
+            .user_ctx  = NULL
+        };
+        register_endpoint(server, &sampling, METRICS_URI_SAMPLING, ENDPOINT_PRIORITY_HIGH);
+
+        // settings
+        httpd_uri_t get_config = {
+            .uri      = "/config",
+            .method   = HTTP_GET,
+            .handler  = get_config_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_config, METRICS_URI_GET_CONFIG, ENDPOINT_PRIORITY_HIGH);
+
+        httpd_uri_t put_config = {
+            .uri      = "/config",
+            .method   = HTTP_PUT,
+            .handler  = put_config_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &put_config, METRICS_URI_PUT_CONFIG, ENDPOINT_PRIORITY_HIGH);
+
+        // alert rules
+        httpd_uri_t get_alerts = {
+            .uri      = "/alerts",
+            .method   = HTTP_GET,
+            .handler  = get_alerts_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_alerts, METRICS_URI_GET_ALERTS, ENDPOINT_PRIORITY_HIGH);
+
+        httpd_uri_t put_alerts = {
+            .uri      = "/alerts",
+            .method   = HTTP_PUT,
+            .handler  = put_alerts_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &put_alerts, METRICS_URI_PUT_ALERTS, ENDPOINT_PRIORITY_HIGH);
+
+        // get last 10 temperatures
+        httpd_uri_t get_last_10_temperatures = {
+            .uri      = "/get_last_10_temperatures",
+            .method   = HTTP_GET,
+            .handler  = get_last_10_temperatures_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_last_10_temperatures, METRICS_URI_GET_LAST_10_TEMPERATURES, ENDPOINT_PRIORITY_HIGH);
+
+        // history query
+        httpd_uri_t get_history = {
+            .uri      = "/history",
+            .method   = HTTP_GET,
+            .handler  = get_history_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_history, METRICS_URI_HISTORY, ENDPOINT_PRIORITY_LOW);
+
+        // channel table
+        httpd_uri_t get_channels = {
+            .uri      = "/channels",
+            .method   = HTTP_GET,
+            .handler  = get_channels_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_channels, METRICS_URI_CHANNELS, ENDPOINT_PRIORITY_HIGH);
+
+        // binary snapshot
+        httpd_uri_t get_snapshot = {
+            .uri      = "/snapshot.bin",
+            .method   = HTTP_GET,
+            .handler  = get_snapshot_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_snapshot, METRICS_URI_SNAPSHOT, ENDPOINT_PRIORITY_HIGH);
+
+        // rolling statistics
+        httpd_uri_t get_statistics = {
+            .uri      = "/stats",
+            .method   = HTTP_GET,
+            .handler  = get_stats_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_statistics, METRICS_URI_STATS, ENDPOINT_PRIORITY_LOW);
+
+        // live samples
+        httpd_uri_t ws = {
+            .uri          = "/ws",
+            .method       = HTTP_GET,
+            .handler      = ws_handler,
+            .user_ctx     = NULL,
+            .is_websocket = true
+        };
+        register_endpoint(server, &ws, METRICS_URI_WS, ENDPOINT_PRIORITY_HIGH);
+
+#if METRICS_ENABLED
+        // prometheus metrics
+        httpd_uri_t get_metrics = {
+            .uri      = "/metrics",
+            .method   = HTTP_GET,
+            .handler  = get_metrics_handler,
+            .user_ctx = NULL
+        };
+        register_endpoint(server, &get_metrics, METRICS_URI_METRICS, ENDPOINT_PRIORITY_LOW);
+#endif
+    }
+
+    return server;
+}
+
+/**
+ * @brief Function for stopping webserver access point.
+ * 
+ * @param server server
+ */
+void stop_webserver(httpd_handle_t server) {
+    err = httpd_stop(server);
+    if (err != ESP_OK) {
+        printf("Error - httpd_stop(): %s\n", esp_err_to_name(err));
+    }
+}
+
+/************************ TELEMETRY ************************/
+
+/**
+ * @brief Function for loading uplink cursor from memory.
+ */
+void load_uplink_cursor() {
+    nvs_handle_t memory_handle;
+
+    err = nvs_open(uplink_memory_name, NVS_READWRITE, &memory_handle);
+    if (err != ESP_OK) {
+        printf("Error - nvs_open(): %s\n", esp_err_to_name(err));
+        return;
+    }
+
+    err = nvs_get_u64(memory_handle, uplink_memory_cursor, &uplink_cursor);
+    if (err != ESP_OK) { // nothing was sent yet
+        uplink_cursor = 0;
+    }
+
+    nvs_close(memory_handle);
+}
+
+/**
+ * @brief Function for storing uplink cursor to memory, called once per acknowledged batch.
+ */
+void store_uplink_cursor() {
+    nvs_handle_t memory_handle;
 
-    err = esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_configuration);
+    err = nvs_open(uplink_memory_name, NVS_READWRITE, &memory_handle);
     if (err != ESP_OK) {
-        printf("Error - esp_wifi_set_config(): %s\n", esp_err_to_name(err));
+        printf("Error - nvs_open(): %s\n", esp_err_to_name(err));
+        return;
     }
 
-    err = esp_wifi_start();
+    err = nvs_set_u64(memory_handle, uplink_memory_cursor, uplink_cursor);
     if (err != ESP_OK) {
-        printf("Error - esp_wifi_start(): %s\n", esp_err_to_name(err));
+        printf("Error - nvs_set_u64(): %s\n", esp_err_to_name(err));
     }
 
-    err = esp_wifi_connect();
+    METRICS_START(start);
+    err = nvs_commit(memory_handle);
     if (err != ESP_OK) {
-        printf("Error - esp_wifi_connect(): %s\n", esp_err_to_name(err));
+        printf("Error - nvs_commit(): %s\n", esp_err_to_name(err));
+        METRICS_COUNT(METRICS_COUNTER_COMMIT_FAILURES, 1);
     }
-}
+    METRICS_STAGE_STOP(METRICS_STAGE_NVS_COMMIT, start);
 
-/************************ RTC ************************/
+    nvs_close(memory_handle);
+}
 
 /**
- * @brief Function for initliazation of server time using NTP protocol.
- *        Inspired by: https://stackoverflow.com/questions/56025619/how-to-resync-time-from-ntp-server-in-esp-idf
+ * @brief Function for encoding batch of records as uplink payload.
+ *        Payload is version byte followed by blocks of at most LOG_BLOCK_MAX_RECORDS records,
+ *        encoded by log_encode_block() as in record log, so server decodes them with same decoder.
+ *        Every block starts with log_block_header_t, whose length gives start of next block.
+ * 
+ * @param records records
+ * @param count count of records
+ * @param payload output buffer of UPLINK_PAYLOAD_SIZE bytes
+ * 
+ * @return size_t length of payload
  */
-void init_time() {
-    time_t now = 0;
-    struct tm timeinfo = {0};
-    int retry = 0;
-    int retry_count = 10;
+size_t encode_uplink_payload(const log_record_t *records, uint16_t count, uint8_t *payload) {
+    size_t len = 0;
 
-    sntp_setoperatingmode(SNTP_OPMODE_POLL);
-    sntp_setservername(0, "sk.pool.ntp.org");
-    sntp_init();
+    payload[len++] = UPLINK_PAYLOAD_VERSION;
 
-    while(timeinfo.tm_year < (2016 - 1900) && ++retry < retry_count)
-    {
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
-        time(&now);
-        localtime_r(&now, &timeinfo);
+    for (uint16_t i = 0; i < count; i += LOG_BLOCK_MAX_RECORDS) {
+        uint16_t block_count = count - i < LOG_BLOCK_MAX_RECORDS ? count - i : LOG_BLOCK_MAX_RECORDS;
+        len += log_encode_block(records + i, block_count, payload + len);
     }
 
-    printf("Time initialized to: %s", asctime(&timeinfo));
-
-    timeinfo.tm_hour += 1; // ours time zone
-    t = mktime(&timeinfo);
+    return len;
 }
 
 /**
- * @brief Function for getting actual time based on RTC.
+ * @brief Function for posting new alert notifications as json, called by telemetry task before records.
+ * 
+ * @param client http client of telemetry task
  */
-void get_time() {
-    time_t rtc_sec = esp_rtc_get_time_us() / 1000000;
-    
-    time_t actual_time = t + rtc_sec;
-    struct tm *time = localtime(&actual_time);
-
-    snprintf(time_as_string, sizeof(time_as_string),
-             "%04d-%02d-%02d %02d:%02d:%02d ",
-             time->tm_year + 1900, time->tm_mon + 1, time->tm_mday,
-             time->tm_hour, time->tm_min, time->tm_sec);
-}
+void uplink_post_alerts(esp_http_client_handle_t client) {
+    static char payload[ALERT_PAYLOAD_SIZE];
+    alert_event_t event;
+    uint32_t sequence = uplink_alert_sent;
+    uint32_t count = 0;
+    int len = snprintf(payload, sizeof(payload), "{\"alerts\":[");
 
-/************************ NON-VOLATILE MEMORY ************************/
+    while (read_alert_event(&sequence, &event) && count < ALERT_EVENTS_SIZE) {
+        if (count == 0) {
+            uplink_alert_sent = sequence; // notifications overwritten in ring are skipped
+        }
+        len += snprintf(payload + len, sizeof(payload) - len, "%s", count > 0 ? "," : "");
+        len += format_alert_event(&event, payload + len, sizeof(payload) - len);
+        ++sequence;
+        ++count;
+    }
 
-/**
- * @brief Function for clearing memory.
- */
-void clear_memory() {
-    nvs_handle_t memory_handle;
-    err = nvs_open(memory_name, NVS_READWRITE, &memory_handle);
-    if (err != ESP_OK) {
-        printf("Error - nvs_open(): %s\n", esp_err_to_name(err));
+    if (count == 0) {
+        return;
     }
+    len += snprintf(payload + len, sizeof(payload) - len, "]}");
 
-    err = nvs_erase_all(memory_handle);
-    if (err != ESP_OK) {
-        printf("Error - nvs_erase_all(): %s\n", esp_err_to_name(err));
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    esp_http_client_delete_header(client, "X-Log-Position");
+    esp_http_client_set_post_field(client, payload, len);
+
+    err = esp_http_client_perform(client);
+    int status = esp_http_client_get_status_code(client);
+    if (err == ESP_OK && status >= 200 && status < 300) {
+        uplink_alert_sent = sequence;
+    } else {
+        printf("Error - uplink_post_alerts - esp_http_client_perform(): %s, status %d\n", esp_err_to_name(err), status);
     }
 
-    nvs_close(memory_handle);
+    esp_http_client_set_header(client, "Content-Type", "application/octet-stream");
 }
 
 /**
- * @brief Function for storing actual temperature to memory.
- *        Inspired by: https://github.com/espressif/esp-idf/blob/master/examples/storage/nvs_rw_value/main/nvs_value_example_main.c
+ * @brief Telemetry task, posts flushed records in batches from persisted cursor.
+ *        Connection is kept alive between posts. Each post carries position of its first record,
+ *        so server can drop batch which was sent again after ack was lost.
+ *        Alert notifications are posted first and wake task before its interval ends.
+ *        Network boot of low power mode returns to deep sleep as soon as notifications and records are drained.
+ * 
+ * @param arg unused
  */
-void store_temperature() {
-    nvs_handle_t memory_handle;
-    uint16_t count = 0;
+void telemetry_task(void *arg) {
+    static log_record_t records[UPLINK_BATCH_RECORDS];
+    static uint8_t payload[UPLINK_PAYLOAD_SIZE];
+    char header[24];
+    uint8_t mac[6] = {0};
+    wifi_ap_record_t ap_info;
 
-    err = nvs_open(memory_name, NVS_READWRITE, &memory_handle);
-    if (err != ESP_OK) {
-        printf("Error - nvs_open(): %s\n", esp_err_to_name(err));
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    load_uplink_cursor();
+
+    esp_http_client_config_t config = {
+        .url = uplink_url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = UPLINK_TIMEOUT_MS,
+        .keep_alive_enable = true,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        printf("Error - esp_http_client_init(): client not created\n");
+        vTaskDelete(NULL);
     }
 
-    err = nvs_get_u16(memory_handle, memory_count, &count);
-    if (err != ESP_OK) { // for example memory is full -> clear memory
-        printf("Error - nvs_get_u16: %s -> clearing memory\n", esp_err_to_name(err));
-        clear_memory();
-        count = 0;
-    } else {
-        ++count;
+    snprintf(header, sizeof(header), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    esp_http_client_set_header(client, "X-Device-Id", header);
+    esp_http_client_set_header(client, "Content-Type", "application/octet-stream");
+
+    while (1) {
+        uint16_t count = 0;
+        bool drained = false;
+
+        if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) { // station is connected
+            uplink_post_alerts(client);
+            drained = uplink_alert_sent == alert_event_count;
+
+            uint64_t position = uplink_cursor;
+            count = log_read_position(&position, records, UPLINK_BATCH_RECORDS);
+
+            if (count > 0) {
+                size_t len = encode_uplink_payload(records, count, payload);
+
+                snprintf(header, sizeof(header), "%llu", (unsigned long long)(position - count));
+                esp_http_client_set_header(client, "X-Log-Position", header);
+                esp_http_client_set_post_field(client, (const char *)payload, len);
+
+                err = esp_http_client_perform(client);
+                int status = esp_http_client_get_status_code(client);
+                if (err == ESP_OK && status >= 200 && status < 300) {
+                    uplink_cursor = position;
+                    store_uplink_cursor();
+                } else {
+                    printf("Error - esp_http_client_perform(): %s, status %d\n", esp_err_to_name(err), status);
+                    count = 0;
+                    drained = false;
+                }
+            }
+
+            if (drained && count < UPLINK_BATCH_RECORDS) { // uplink caught up with record log
+                uplink_unsent_records = 0;
+            } else {
+                drained = false;
+            }
+        }
+
+        // awake timer is fired at once, it stops wifi and enters deep sleep
+        if (uplink_boot && drained && awake_timer != NULL) {
+            printf("Uplink drained\n");
+            uplink_boot = false;
+            esp_timer_stop(awake_timer);
+            esp_timer_start_once(awake_timer, 0);
+        }
+
+        // full batch -> more records are probably waiting
+        if (count < UPLINK_BATCH_RECORDS) {
+            ulTaskNotifyTake(pdTRUE, (uplink_boot ? UPLINK_BOOT_RETRY_MS : uplink_interval_ms) / portTICK_PERIOD_MS);
+        }
     }
+}
+
+/************************ TASKS ************************/
+
+/**
+ * @brief Function for computing period until next sample, called after every sample.
+ *        Adaptive sampling shortens period in proportion to change of temperature
+ *        and uses shortest period near threshold or when threshold would be reached within two samples,
+ *        stable temperature lengthens period by SAMPLE_ADAPTIVE_BACKOFF per sample.
+ * 
+ * @return uint32_t period in milliseconds
+ */
+uint32_t next_sample_period() {
+    channel_t config[CHANNEL_COUNT];
+    double hysteresis;
+    double change = 0.0;
+    double distance = INFINITY;
 
-    // time
-    get_time();
-    char temperature_as_string[8];
-    snprintf(temperature_as_string, sizeof(temperature_as_string), "%.2f", temperature);
+    read_channels(config, &hysteresis);
 
-    // time + temperature
-    char record[strlen(time_as_string) + strlen(temperature_as_string) + 1];
-    strcpy(record, time_as_string);
-    strcat(record, temperature_as_string);
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        double value = temperature[channel];
+        if (isnan(value)) {
+            continue;
+        }
 
-    // temperature key for memory
-    char temperature_key[strlen(memory_temperature) + 2];
-    strcpy(temperature_key, memory_temperature);
-    snprintf(temperature_key + strlen(memory_temperature), 8, "%d", count);
+        if (schedule_last_valid[channel]) {
+            change = fmax(change, fabs(value - schedule_last_temperature[channel]));
+        }
+        if (config[channel].threshold != THRESHOLD_DEFAULT_VALUE) {
+            distance = fmin(distance, fabs(value - config[channel].threshold));
+        }
 
-    err = nvs_set_str(memory_handle, temperature_key, record);
-    if (err != ESP_OK) { // for example memory is full -> clear memory
-        printf("Error - nvs_set_str: %s -> clearing memory\n", esp_err_to_name(err));
-        clear_memory();
-        count = 0;
+        schedule_last_temperature[channel] = value;
+        schedule_last_valid[channel] = true;
     }
 
-    // storing actual count of records in memory so I can get last 10 records
-    err = nvs_set_u16(memory_handle, memory_count, count);
-    if (err != ESP_OK) { // for example memory is full -> clear memory
-        printf("Error - nvs_set_u16: %s -> clearing memory\n", esp_err_to_name(err));
-        clear_memory();
-        count = 0;
+    if (!adaptive_sampling) {
+        current_period_ms = sample_period_ms;
+        return current_period_ms;
     }
 
-    err = nvs_commit(memory_handle);
-    if (err != ESP_OK) {
-        printf("Error - nvs_commit(): %s\n", esp_err_to_name(err));
+    double period = current_period_ms;
+    if (distance <= SAMPLE_ADAPTIVE_MARGIN + hysteresis || distance < 2 * change) {
+        period = adaptive_period_min_ms;
+    } else if (change > SAMPLE_ADAPTIVE_STEP) {
+        period = period * SAMPLE_ADAPTIVE_STEP / change;
+    } else if (change < SAMPLE_ADAPTIVE_STEP / 4) {
+        period = period * SAMPLE_ADAPTIVE_BACKOFF;
     }
 
-    nvs_close(memory_handle);
+    current_period_ms = period < adaptive_period_min_ms ? adaptive_period_min_ms :
+                        period > adaptive_period_max_ms ? adaptive_period_max_ms : (uint32_t)period;
+
+    return current_period_ms;
 }
 
 /**
- * @brief Get the last 10 temperatures from memory.
- *        Inspired by: https://github.com/espressif/esp-idf/blob/master/examples/storage/nvs_rw_value/main/nvs_value_example_main.c
+ * @brief Sampler task, measures temperature, handles threshold and passes sample to storage task.
+ * 
+ * @param arg unused
  */
-void get_last_10_temperatures_from_nvm() {
-    nvs_handle_t memory_handle;
-    uint16_t count = 0; // records in memory
-    size_t s;
-    char temperature_key[strlen(memory_temperature) + 2]; // temperature key for actual record
-
-    err = nvs_open(memory_name, NVS_READWRITE, &memory_handle);
-    if (err != ESP_OK) {
-        printf("Error - nvs_open(): %s\n", esp_err_to_name(err));
-    }
+void sampler_task(void *arg) {
+    TickType_t last_wake = xTaskGetTickCount();
 
-    err = nvs_get_u16(memory_handle, memory_count, &count); // get count of records in memory
-    if (err != ESP_OK) {
-        printf("Error - nvs_get_u16: %s\n", esp_err_to_name(err));
-    }
+    while (1) {
+        METRICS_START(start);
+        get_temperature();
+        METRICS_STAGE_STOP(METRICS_STAGE_GET_TEMPERATURE, start);
+        METRICS_COUNT(METRICS_COUNTER_SAMPLES, 1);
+        update_stats();
+        handle_threshold();
 
-    int index = 0; // index for temperature_arr
-    // getting last 10 records
-    for (size_t i = count; i > (count - 10 >= 0 ? count - 10 : -1); --i) {
-        strcpy(temperature_key, memory_temperature);
-        snprintf(temperature_key + strlen(memory_temperature), 8, "%d", (unsigned int)count - index);
-        err = nvs_get_str(memory_handle, temperature_key, temperature_arr[count - i], &s);
+        sample_t sample;
+        build_sample(&sample);
+        publish_sample(&sample);
+        notify_subscribers();
+        if (handle_alerts(sample.time_us)) {
+            notify_alerts();
+        }
 
-        if (err != ESP_OK) {
-            printf("Error - nvs_get_str: %s\n", esp_err_to_name(err));
+        if (!sample_queue_push(&sample)) {
+            ++dropped_samples;
+            printf("Error - sample_queue_push(): queue is full, dropped samples: %lu\n", (unsigned long)dropped_samples);
         }
+        xTaskNotifyGive(storage_task_handle);
 
-        ++index;
+        // deadline moves by exactly one period, so time spent in sampling does not shift samples
+        if (xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(next_sample_period())) == pdFALSE) {
+            // sample took longer than period, missed samples are skipped instead of taken in burst
+            last_wake = xTaskGetTickCount();
+        }
     }
-
-    nvs_close(memory_handle);
 }
 
-/************************ WIFI ACCESS POINT ************************/
-
 /**
- * @brief Function for handling get root request.
- * 
- * @param req request
+ * @brief Storage task, drains sample queue to memory.
  * 
- * @return esp_err_t esp state
+ * @param arg unused
  */
-esp_err_t get_root_handler(httpd_req_t *req) {
-    char response[2048];
+void storage_task(void *arg) {
+    sample_t sample;
 
-    // html string of page
-    snprintf(response, sizeof(response),
-             "<!DOCTYPE HTML><html><head><title>ESP32 - Temperature tool</title><meta name='viewport' content='width=device-width, initial-scale=1.0' charset='UTF-8'><style> h2, p { font-family: Arial, sans-serif; }</style><script>function updateTemperature(){fetch('/get_temperature').then(response => response.text()).then(newTemperature => {document.getElementById('temperature').innerText = newTemperature + ' \u00B0C';});}function setThreshold(){var thresholdValue = document.getElementById('threshold').value;fetch('/set_threshold',{method: 'POST',headers: {'Content-Type': 'application/x-www-form-urlencoded',},body: 'threshold=' + thresholdValue,}); var inputElement = document.getElementById('threshold_button'); var paragraph = document.createElement('p'); paragraph.textContent = 'Threshold set successfully.'; inputElement.insertAdjacentElement('afterend', paragraph); setTimeout(function() { paragraph.parentNode.removeChild(paragraph);}, 3000); }function getLast10Temperatures(){fetch('/get_last_10_temperatures').then(response => response.json()).then(data => { const temperatureContainer = document.getElementById('temperature-container'); temperatureContainer.innerHTML = ''; for (let i = 0; i < data.temperature.length; i++) { const newParagraph = document.createElement('p'); newParagraph.innerText = data.temperature[i]; temperatureContainer.appendChild(newParagraph);}});} setInterval(updateTemperature, 2000);setInterval(getLast10Temperatures, 2000);getLast10Temperatures();updateTemperature();</script></head><body><h2>Actual temperature:</h2><p id='temperature'>%.2f &deg;C</p><h2>Set temperature threshold:</h2><input type='number' step='0.01' id='threshold' min='-50.00'> <button onclick='setThreshold()' id='threshold_button'>Set</button><br /><h2>Last 10 temperatures</h2><div id='temperature-container'></div></body></html>", temperature);
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-    err = httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
-    if (err != ESP_OK) {
-        printf("Error - get_root_handler - httpd_resp_send(): %s\n", esp_err_to_name(err));
+        while (sample_queue_pop(&sample)) {
+            METRICS_START(start);
+            store_temperature(&sample);
+            METRICS_STAGE_STOP(METRICS_STAGE_STORE_TEMPERATURE, start);
+        }
     }
-    
-    return ESP_OK;
 }
 
 /**
- * @brief Function for handling get temperature request.
- * 
- * @param req request
- * 
- * @return esp_err_t esp state
+ * @brief Function for starting sampler and storage task.
  */
-static esp_err_t get_temperature_handler(httpd_req_t *req) {
-    char response[16];
-    snprintf(response, sizeof(response), "%.2f", temperature);
-    err = httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
-    if (err != ESP_OK) {
-        printf("Error - get_temperature_handler - httpd_resp_send(): %s\n", esp_err_to_name(err));
+void start_tasks() {
+    if (!create_task(storage_task, "storage", STORAGE_STACK_SIZE, STATIC_BUFFER(storage_task_stack), STATIC_BUFFER(&storage_task_buffer),
+                     STORAGE_TASK_PRIORITY, &storage_task_handle, STORAGE_TASK_CORE)) {
+        printf("Error - create_task(): storage task not created\n");
     }
 
-    return ESP_OK;
+    if (!create_task(sampler_task, "sampler", SAMPLER_STACK_SIZE, STATIC_BUFFER(sampler_task_stack), STATIC_BUFFER(&sampler_task_buffer),
+                     SAMPLER_TASK_PRIORITY, &sampler_task_handle, SAMPLER_TASK_CORE)) {
+        printf("Error - create_task(): sampler task not created\n");
+    }
+
+    if (strlen(uplink_url) > 0 &&
+        !create_task(telemetry_task, "telemetry", TELEMETRY_STACK_SIZE, STATIC_BUFFER(telemetry_task_stack), STATIC_BUFFER(&telemetry_task_buffer),
+                     UPLINK_TASK_PRIORITY, &telemetry_task_handle, UPLINK_TASK_CORE)) {
+        printf("Error - create_task(): telemetry task not created\n");
+    }
 }
 
+/************************ ULP ************************/
+
 /**
- * @brief Function for handling get last 10 temperatures request.
- * 
- * @param req request
- * @return esp_err_t esp state
+ * @brief Function for starting threshold check on ulp coprocessor before deep sleep.
+ *        Ulp measures first channel every ULP_CHECK_PERIOD_MS and wakes main cpu when threshold state changes,
+ *        thresholds of other channels are checked only when samples are taken.
  */
-static esp_err_t get_last_10_temperatures_from_nvm_handler(httpd_req_t *req) {
-    get_last_10_temperatures_from_nvm();
+void arm_ulp_threshold() {
+    channel_t config[CHANNEL_COUNT];
+    double hysteresis;
+    read_channels(config, &hysteresis); // deep sleep can be entered while settings are written
+    channel_t *channel = &config[0];
+    const ulp_insn_t program[] = {
+        I_ADC(R1, 0, channel->adc_channel),
+        I_MOVI(R3, 0),
+        I_ST(R1, R3, ULP_LAST_RAW),
+        I_LD(R0, R3, ULP_STATE),
+        M_BGE(ULP_LABEL_OVERCOME, 1),
+
+        // threshold is overcome when raw <= raw on, subtraction overflows otherwise
+        I_LD(R2, R3, ULP_RAW_ON),
+        I_SUBR(R2, R2, R1),
+        M_BXF(ULP_LABEL_DONE),
+        I_MOVI(R0, 1),
+        I_ST(R0, R3, ULP_STATE),
+        I_WAKE(),
+        M_BX(ULP_LABEL_DONE),
+
+        // overcome threshold is released when raw > raw off
+        M_LABEL(ULP_LABEL_OVERCOME),
+        I_LD(R2, R3, ULP_RAW_OFF),
+        I_SUBR(R2, R2, R1),
+        M_BXF(ULP_LABEL_RELEASE),
+        M_BX(ULP_LABEL_DONE),
+
+        M_LABEL(ULP_LABEL_RELEASE),
+        I_MOVI(R0, 0),
+        I_ST(R0, R3, ULP_STATE),
+        I_WAKE(),
+
+        M_LABEL(ULP_LABEL_DONE),
+        I_HALT(),
+    };
+    size_t size = sizeof(program) / sizeof(ulp_insn_t);
+
+    if (channel->threshold == THRESHOLD_DEFAULT_VALUE) {
+        return;
+    }
 
-    cJSON *json_root = cJSON_CreateObject();
-    cJSON *json_array = cJSON_CreateArray();
+    // ADC is handed over from DMA controller to ulp
+    if (adc_handle != NULL) {
+        adc_continuous_stop(adc_handle);
+        adc_continuous_deinit(adc_handle);
+        adc_handle = NULL;
+    }
 
-    for (int i = 0; i < 10; i++) {
-        cJSON_AddItemToArray(json_array, cJSON_CreateString(temperature_arr[i]));
+    ulp_adc_cfg_t adc_config = {
+        .adc_n = ADC_UNIT_1,
+        .channel = channel->adc_channel,
+        .width = ADC_BITWIDTH_DEFAULT,
+        .atten = channel->atten,
+        .ulp_mode = ADC_ULP_MODE_FSM,
+    };
+    err = ulp_adc_init(&adc_config);
+    if (err != ESP_OK) {
+        printf("Error - ulp_adc_init(): %s\n", esp_err_to_name(err));
+        return;
     }
-    cJSON_AddItemToObject(json_root, "temperature", json_array);
-    const char *json_str = cJSON_PrintUnformatted(json_root);
 
-    err = httpd_resp_set_type(req, "application/json");
+    err = ulp_process_macros_and_load(ULP_PROGRAM_OFFSET, program, &size);
     if (err != ESP_OK) {
-        printf("Error - get_last_10_temperatures_from_nvm_handler - httpd_resp_set_type(): %s\n", esp_err_to_name(err));
+        printf("Error - ulp_process_macros_and_load(): %s\n", esp_err_to_name(err));
+        return;
     }
 
-    err = httpd_resp_send(req, json_str, strlen(json_str));
+    // thresholds are converted back before calibration of channel
+    RTC_SLOW_MEM[ULP_RAW_ON] = temperature_to_raw(0, (channel->threshold - channel->offset) / channel->gain);
+    RTC_SLOW_MEM[ULP_RAW_OFF] = temperature_to_raw(0, (channel->threshold - hysteresis - channel->offset) / channel->gain);
+    RTC_SLOW_MEM[ULP_STATE] = channel->threshold_overcome;
+
+    err = ulp_set_wakeup_period(0, ULP_CHECK_PERIOD_MS * 1000);
     if (err != ESP_OK) {
-        printf("Error - get_last_10_temperatures_from_nvm_handler - httpd_resp_send(): %s\n", esp_err_to_name(err));
+        printf("Error - ulp_set_wakeup_period(): %s\n", esp_err_to_name(err));
     }
 
-    free((void *)json_str);
-    cJSON_Delete(json_root);
+    err = ulp_run(ULP_PROGRAM_OFFSET);
+    if (err != ESP_OK) {
+        printf("Error - ulp_run(): %s\n", esp_err_to_name(err));
+        return;
+    }
 
-    return ESP_OK;
+    esp_sleep_enable_ulp_wakeup();
 }
 
 /**
- * @brief Function for handling set threshold request.
- * 
- * @param req request
- * @return esp_err_t esp state
+ * @brief Function for handling wake by ulp, takes over threshold state evaluated by ulp.
  */
-static esp_err_t post_set_threshold_handler(httpd_req_t *req) {
-    char buffer[20] = {'\0'};
-    char thresh[10] = {'\0'};
-    int len = req->content_len;
-    int count = 0;
+void handle_ulp_wake() {
+    ulp_timer_stop();
 
-    httpd_req_recv(req, buffer, req->content_len);
+    channels[0].threshold_overcome = RTC_SLOW_MEM[ULP_STATE] & 0xFFFF;
+    printf("Threshold of channel 0 %s (ulp, raw %lu)\n", channels[0].threshold_overcome ? "overcome" : "released", (unsigned long)(RTC_SLOW_MEM[ULP_LAST_RAW] & 0xFFFF));
 
-    // getting just threshold value from request
-    for (int i = 0; i < len; i++) {
-        if (buffer[i] == '=') {
-            count++;
-        } else if (count != 0) {
-            thresh[count - 1] = buffer[i];
-            count++;
-        }
+    // led is configured after wake, so only its level is updated
+    threshold_overcome = false;
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        threshold_overcome |= channels[channel].threshold_overcome;
     }
-
-    gpio_set_level(GPIO_LED, 0);
-    threshold = atof(thresh);
-    printf("Threshold set to: %.2f\n", threshold);
-
-    return ESP_OK;
 }
 
+/************************ LOW POWER ************************/
+
 /**
- * @brief Function for configuration of web server access point.
- *        Inspired by: https://esp32tutorials.com/esp32-web-server-esp-idf/
+ * @brief Function for entering deep sleep until next sample or press of wake button.
+ *        Samples stay in staging buffer in RTC memory, led keeps its level.
  */
-void wifi_configuration_access_point() {
-    err = esp_netif_init();
-    if (err != ESP_OK) {
-        printf("Error - esp_netif_init(): %s\n", esp_err_to_name(err));
+void enter_deep_sleep() {
+    flush_settings();
+
+    // flash must not be written while entering sleep
+    if (log_mutex != NULL) {
+        xSemaphoreTake(log_mutex, portMAX_DELAY);
     }
 
-    esp_netif_create_default_wifi_ap();
+    if (threshold_overcome) {
+        gpio_hold_en(GPIO_LED);
+        gpio_deep_sleep_hold_en();
+    }
 
-    wifi_init_config_t config = WIFI_INIT_CONFIG_DEFAULT();
-    err = esp_wifi_init(&config);
-    if (err != ESP_OK) {
-        printf("Error - esp_wifi_init(): %s\n", esp_err_to_name(err));
+    arm_ulp_threshold();
+    anchor_time();
+
+    // samples are scheduled on RTC time, so time spent awake does not shift them
+    uint64_t now = esp_rtc_get_time_us();
+    if (next_sample_rtc_us <= now) {
+        next_sample_rtc_us = now + (uint64_t)current_period_ms * 1000;
     }
 
-    wifi_config_t wifi_config = {
-        .ap = {
-            .ssid = WIFI_SSID,
-            .ssid_len = strlen(WIFI_SSID),
-            .authmode = WIFI_AUTH_OPEN,
-            .max_connection = 10,
-        },
+    esp_sleep_enable_timer_wakeup(next_sample_rtc_us - now);
+    esp_sleep_enable_ext0_wakeup(WAKE_BUTTON_GPIO, 0);
+
+    esp_deep_sleep_start();
+}
+
+/**
+ * @brief Function called after device was awake for AWAKE_TIME_MS.
+ * 
+ * @param arg unused
+ */
+void awake_timer_callback(void *arg) {
+    if (!low_power_mode) { // mode was disabled while timer was running
+        return;
+    }
+
+    printf("Returning to deep sleep\n");
+    esp_wifi_stop();
+    enter_deep_sleep();
+}
+
+/**
+ * @brief Function for scheduling return to deep sleep, used when device was woken by button, for uplink or powered on.
+ *        Timer is always created, so low power mode can be enabled by settings, it is started only in low power mode.
+ *        Network boot is ended earlier by telemetry task once uplink is drained.
+ */
+void schedule_deep_sleep() {
+    esp_timer_create_args_t timer_args = {
+        .callback = awake_timer_callback,
+        .name = "awake",
     };
-    
-    err = esp_wifi_set_mode(WIFI_MODE_AP);
+    err = esp_timer_create(&timer_args, &awake_timer);
     if (err != ESP_OK) {
-        printf("Error - esp_wifi_set_mode(): %s\n", esp_err_to_name(err));
+        printf("Error - esp_timer_create(): %s\n", esp_err_to_name(err));
+        return;
     }
 
-    err = esp_wifi_set_config(WIFI_IF_AP, &wifi_config);
-    if (err != ESP_OK) {
-        printf("Error - esp_wifi_set_config(): %s\n", esp_err_to_name(err));
+    if (!low_power_mode) {
+        return;
     }
 
-    err = esp_wifi_start();
+    err = esp_timer_start_once(awake_timer, (uint64_t)(uplink_boot ? UPLINK_BOOT_TIMEOUT_MS : AWAKE_TIME_MS) * 1000);
     if (err != ESP_OK) {
-        printf("Error - esp_wifi_start(): %s\n", esp_err_to_name(err));
+        printf("Error - esp_timer_start_once(): %s\n", esp_err_to_name(err));
     }
 }
 
 /**
- * @brief Function where endpoints are defined.
- *        Inspired by: https://esp32tutorials.com/esp32-web-server-esp-idf/
- * 
- * @return httpd_handle_t server
+ * @brief Function for taking one sample after wake by RTC timer or ulp, wifi is not started.
+ *        Flash is initialized and written only when staging buffer is full.
  */
-httpd_handle_t define_endpoints() {
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    httpd_handle_t server = NULL;
+void low_power_cycle() {
+    log_mutex = create_mutex(STATIC_BUFFER(&log_mutex_buffer));
+    if (!log_batch_valid()) {
+        log_batch.magic = LOG_BATCH_MAGIC;
+        log_batch.count = 0;
+    }
 
-    if (httpd_start(&server, &config) == ESP_OK) {
-        // root
-        httpd_uri_t get_root = {
-            .uri      = "/",
-            .method   = HTTP_GET,
-            .handler  = get_root_handler,
-            .user_ctx = NULL
-        };
-        httpd_register_uri_handler(server, &get_root);
+    // ulp thresholds are also computed from calibrated tables
+    calibrate_adc();
 
-        // get temperature
-        httpd_uri_t get_temperature = {
-            .uri      = "/get_temperature",
-            .method   = HTTP_GET,
-            .handler  = get_temperature_handler,
-            .user_ctx = NULL
-        };
-        httpd_register_uri_handler(server, &get_temperature);
+    // threshold crossing, only led is updated
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_ULP) {
+        handle_ulp_wake();
+        configure_led();
+        enter_deep_sleep();
+    }
+    ulp_timer_stop();
 
-        // set threshold
-        httpd_uri_t set_threshold = {
-            .uri       = "/set_threshold",
-            .method    = HTTP_POST,
-            .handler   = post_set_threshold_handler,
-            .user_ctx  = NULL
-        };
-        httpd_register_uri_handler(server, &set_threshold);
+    configure_led();
+    configure_adc();
+    vTaskDelay(LOW_POWER_ADC_WINDOW_MS / portTICK_PERIOD_MS);
+    get_temperature();
+    update_stats();
 
-        // get last 10 temperatures
-        httpd_uri_t get_last_10_temperatures = {
-            .uri      = "/get_last_10_temperatures",
-            .method   = HTTP_GET,
-            .handler  = get_last_10_temperatures_from_nvm_handler,
-            .user_ctx = NULL
-        };
-        httpd_register_uri_handler(server, &get_last_10_temperatures);
+    handle_threshold();
+    next_sample_rtc_us += (uint64_t)next_sample_period() * 1000;
+
+    sample_t sample;
+    build_sample(&sample);
+    handle_alerts(sample.time_us); // notifications are delivered by next network boot, see uplink_due()
+
+    // one record per channel is staged, closed rollup period is written at once
+    if (log_batch.count + CHANNEL_COUNT >= log_batch_size || rollup_closes(resolve_time_us(sample.time_us) / 1000000)) {
+        init_record_log();
     }
+    store_temperature(&sample);
 
-    return server;
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (sample.temperature[channel] != TEMPERATURE_INVALID) {
+            ++uplink_unsent_records;
+        }
+    }
+
+    enter_deep_sleep();
 }
 
 /**
- * @brief Function for stopping webserver access point.
+ * @brief Function for checking if wake by RTC timer should boot with network to drain uplink instead of taking low power sample.
+ *        Network boot is due with new alert notifications or full uplink batch of stored records,
+ *        at most once per ALERT_NOTIFY_INTERVAL_US, so unreachable server does not keep device awake,
+ *        and with any stored record after uplink_interval_ms of RTC time since last network boot.
  * 
- * @param server server
+ * @return bool true if network boot is due
  */
-void stop_webserver(httpd_handle_t server) {
-    err = httpd_stop(server);
-    if (err != ESP_OK) {
-        printf("Error - httpd_stop(): %s\n", esp_err_to_name(err));
+bool uplink_due() {
+    uint64_t elapsed_us = esp_rtc_get_time_us() - uplink_last_rtc_us;
+    bool urgent = alert_event_count != uplink_alert_sent || uplink_unsent_records >= UPLINK_BATCH_RECORDS;
+
+    if (strlen(uplink_url) == 0) {
+        return false;
     }
+
+    return (urgent && elapsed_us >= ALERT_NOTIFY_INTERVAL_US) ||
+           (uplink_unsent_records > 0 && elapsed_us >= (uint64_t)uplink_interval_ms * 1000);
 }
 
 /************************ MAIN ************************/
 
 void app_main() {    
+    init_timebase();
+
+    // statistics are kept during deep sleep, so moving average of threshold input continues
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    if (cause == ESP_SLEEP_WAKEUP_UNDEFINED) {
+        init_stats();
+    }
+
+    // woken only to take sample or to handle threshold crossing, unless uplink needs network
+    if (low_power_mode && cause == ESP_SLEEP_WAKEUP_TIMER && uplink_due()) {
+        printf("Network boot for uplink\n");
+        uplink_boot = true;
+        uplink_last_rtc_us = esp_rtc_get_time_us(); // failed boot is not repeated before next interval
+    } else if (low_power_mode && (cause == ESP_SLEEP_WAKEUP_TIMER || cause == ESP_SLEEP_WAKEUP_ULP)) {
+        low_power_cycle();
+    }
+    ulp_timer_stop();
+
     err = nvs_flash_init();
     if (err != ESP_OK) {
         printf("Error - nvs_flash_init(): %s\n", esp_err_to_name(err));
     }
 
-    // wifi station
-    wifi_configuration_station();
+    // settings, before everything which uses them
+    load_settings();
 
-    // rtc
-    init_time();
+    // record log
+    init_record_log();
+    init_record_log_batch();
+    load_history_from_nvm();
 
-    // wifi access point
-    wifi_configuration_access_point();
-    httpd_handle_t server = define_endpoints();
-    
     // adc
+    calibrate_adc();
     configure_adc();
 
     // led
     configure_led();
     
-    printf("Program initialized successfully.\n");
+    // sampling and storage start before network, samples are timestamped relative to boot until time is synchronized
+    start_tasks();
 
-    while (1) {
-        get_temperature();
-        handle_threshold();
-        store_temperature();
+    // wifi station and access point
+    wifi_configuration();
 
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
-    }
+    // rtc
+    init_time();
+
+    // web server
+    server = define_endpoints();
 
-    stop_webserver(server);
+    // low power, mode is loaded with settings
+    schedule_deep_sleep();
+
+    print_memory_budget();
+    printf("Program initialized successfully.\n");
 }
 
 /*** End of main.c ***/
@@ -0,0 +1,48 @@
+/*
+ * @file memory_budget.h
+ * @brief Sizes of all buffers, queues and task stacks of application.
+ *        With STATIC_ALLOCATION tasks, queues and semaphores are created in static buffers, so RAM of application
+ *        is fixed at link time and heap is left to wifi, lwip, web server and drivers, which allocate it once at start.
+ */
+
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#ifndef STATIC_ALLOCATION
+#define STATIC_ALLOCATION 1 // 0 creates tasks, queues and semaphores on heap
+#endif
+
+#if STATIC_ALLOCATION
+#define STATIC_BUFFER(buffer) (buffer) // static buffer passed to create function
+#else
+#define STATIC_BUFFER(buffer) NULL // buffer is not declared, object is allocated on heap
+#endif
+
+// task stacks in bytes
+#define SAMPLER_STACK_SIZE 4096 // stack size of sampler task
+#define STORAGE_STACK_SIZE 4096 // stack size of storage task
+#define TELEMETRY_STACK_SIZE 4096 // stack size of telemetry task, esp_http_client runs on it
+#define HTTPD_STACK_SIZE 4096 // stack size of httpd task, response writer and body parser live on it
+#define HTTPD_WORKER_COUNT 2 // count of worker tasks which handle long requests
+#define HTTPD_WORKER_STACK_SIZE 4096 // stack size of worker task
+
+// buffers
+#define SAMPLE_QUEUE_SIZE 64 // capacity of sample queue, power of two
+#define HISTORY_SIZE 10 // count of most recent samples kept in RAM
+#define UPLINK_BATCH_RECORDS 128 // maximal count of records in one post
+#define UPLINK_PAYLOAD_SIZE (1 + (UPLINK_BATCH_RECORDS + LOG_BLOCK_MAX_RECORDS - 1) / LOG_BLOCK_MAX_RECORDS * LOG_BLOCK_MAX_SIZE) // encoded post, version and largest blocks of batch, LOG_* of pipeline.h
+#define SETTINGS_BODY_MAX 1024 // maximal length of body of settings request
+#define REQUEST_CHUNK_SIZE 64 // size of chunk of body passed to parser
+#define ALERT_RULES_MAX 8 // capacity of alert rule table
+#define ALERT_EVENTS_SIZE 16 // capacity of ring of alert notifications, power of two
+#define ALERT_EVENT_MAX_SIZE 112 // longest alert notification as json
+#define ALERT_PAYLOAD_SIZE (16 + ALERT_EVENTS_SIZE * ALERT_EVENT_MAX_SIZE) // posted alert notifications
+
+// rtc slow memory, RTC_DATA_ATTR and RTC_NOINIT_ATTR variables share it with ulp program
+#define RTC_SLOW_MEM_SIZE 8192 // size of RTC slow memory of ESP32
+#define ULP_RESERVE_SIZE 512 // CONFIG_ULP_COPROC_RESERVE_MEM, data words and program of ulp at start of RTC slow memory
+#define RTC_DATA_BUDGET (RTC_SLOW_MEM_SIZE - ULP_RESERVE_SIZE) // bytes left for variables kept during deep sleep
+// check of sum of sizes of all variables kept during deep sleep, placed after last of them
+#define RTC_BUDGET_CHECK(footprint) _Static_assert((footprint) <= RTC_DATA_BUDGET, "variables kept during deep sleep do not fit RTC slow memory")
+
+#endif
@@ -0,0 +1,902 @@
+/*
+ * @file pipeline.c
+ * @brief Hardware independent part of measuring, storing and serving temperature, see pipeline.h.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pipeline.h"
+
+/************************ TEMPERATURE CONVERSION ************************/
+
+// lookup table entry in centi-degrees, evaluated by compiler, saturated to int16_t
+#define LUT_CENTI(mV) (100.0 * TEMPERATURE_FROM_MV(mV))
+#define LUT_ENTRY(mV) ((int16_t)(LUT_CENTI(mV) <= INT16_MIN ? INT16_MIN : LUT_CENTI(mV) >= INT16_MAX ? INT16_MAX : LUT_CENTI(mV) + (LUT_CENTI(mV) >= 0 ? 0.5 : -0.5)))
+#define LUT_ENTRIES_4(i) LUT_ENTRY(i), LUT_ENTRY(i + 1), LUT_ENTRY(i + 2), LUT_ENTRY(i + 3)
+#define LUT_ENTRIES_16(i) LUT_ENTRIES_4(i), LUT_ENTRIES_4(i + 4), LUT_ENTRIES_4(i + 8), LUT_ENTRIES_4(i + 12)
+#define LUT_ENTRIES_64(i) LUT_ENTRIES_16(i), LUT_ENTRIES_16(i + 16), LUT_ENTRIES_16(i + 32), LUT_ENTRIES_16(i + 48)
+#define LUT_ENTRIES_256(i) LUT_ENTRIES_64(i), LUT_ENTRIES_64(i + 64), LUT_ENTRIES_64(i + 128), LUT_ENTRIES_64(i + 192)
+#define LUT_ENTRIES_1024(i) LUT_ENTRIES_256(i), LUT_ENTRIES_256(i + 256), LUT_ENTRIES_256(i + 512), LUT_ENTRIES_256(i + 768)
+
+// temperature in centi-degrees for every millivolt
+const int16_t temperature_lut[LUT_SIZE] = {
+    LUT_ENTRIES_1024(0), LUT_ENTRIES_1024(1024), LUT_ENTRIES_1024(2048), LUT_ENTRIES_1024(3072)
+};
+
+
+/**
+ * @brief Function for converting raw ADC value to temperature by lookup table.
+ * 
+ * @param lut lookup table with LUT_SIZE entries indexed by raw code
+ * @param raw raw value with ADC_FRACTION_BITS
+ * @param interpolate neighbouring entries are linearly interpolated, fraction bits are dropped otherwise
+ * 
+ * @return double temperature
+ */
+double lut_convert(const int16_t *lut, uint32_t raw, bool interpolate) {
+    uint32_t index = raw >> ADC_FRACTION_BITS;
+
+    if (index >= LUT_SIZE - 1 || !interpolate) {
+        return lut[index < LUT_SIZE ? index : LUT_SIZE - 1] / 100.0;
+    }
+
+    int32_t fraction = raw & ((1 << ADC_FRACTION_BITS) - 1);
+    int32_t low = lut[index];
+    int32_t high = lut[index + 1];
+
+    return (low + (((high - low) * fraction) >> ADC_FRACTION_BITS)) / 100.0;
+}
+
+/**
+ * @brief Function for finding raw code of temperature in lookup table.
+ *        Table falls with raw code, so it is searched by bisection.
+ * 
+ * @param lut lookup table with LUT_SIZE entries indexed by raw code
+ * @param value temperature
+ * 
+ * @return uint32_t highest raw value with temperature not lower than value
+ */
+uint32_t lut_find_raw(const int16_t *lut, double value) {
+    int32_t centi = (int32_t)lround(value * 100.0);
+    uint32_t low = 0;
+    uint32_t high = LUT_SIZE;
+
+    while (low < high) {
+        uint32_t middle = (low + high) / 2;
+        if (lut[middle] >= centi) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low > 0 ? low - 1 : 0;
+}
+
+/**
+ * @brief Function for evaluating threshold with hysteresis.
+ * 
+ * @param value compared temperature
+ * @param threshold threshold
+ * @param hysteresis width of band below threshold where overcome threshold stays overcome
+ * @param overcome threshold was overcome
+ * 
+ * @return bool threshold is overcome
+ */
+bool threshold_evaluate(double value, double threshold, double hysteresis, bool overcome) {
+    // temperature is higher than threshold or 
+    // if threshold was set still make led on if temperature is higher than threshold - hysteresis
+    return value >= threshold || (overcome && value >= threshold - hysteresis);
+}
+
+/************************ RECORD ENCODING ************************/
+
+/**
+ * @brief Function for encoding unsigned number as varint, 7 bits per byte from least significant ones.
+ * 
+ * @param out output buffer, at least 5 bytes
+ * @param value value
+ * 
+ * @return size_t count of written bytes
+ */
+size_t varint_encode(uint8_t *out, uint32_t value) {
+    size_t len = 0;
+
+    while (value >= 0x80) {
+        out[len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[len++] = value;
+
+    return len;
+}
+
+/**
+ * @brief Function for decoding varint.
+ * 
+ * @param data position in buffer, moved after varint
+ * @param end end of buffer
+ * @param value output value
+ * 
+ * @return bool false if varint is truncated
+ */
+bool varint_decode(const uint8_t **data, const uint8_t *end, uint32_t *value) {
+    uint32_t result = 0;
+
+    for (uint8_t shift = 0; shift < 35 && *data < end; shift += 7) {
+        uint8_t byte = *(*data)++;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Function for computing check value of block, Fletcher-16 of whole block except check itself.
+ * 
+ * @param block block
+ * @param length length of block
+ * 
+ * @return uint16_t check value
+ */
+uint16_t log_block_check(const uint8_t *block, uint16_t length) {
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+
+    for (uint16_t i = 0; i < length; i++) {
+        if (i == offsetof(log_block_header_t, check) || i == offsetof(log_block_header_t, check) + 1) {
+            continue;
+        }
+        sum1 = (sum1 + block[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+
+    return (sum2 << 8) | sum1;
+}
+
+/**
+ * @brief Function for encoding records as block.
+ *        Timestamps are left out when samples follow with fixed period,
+ *        new sample starts with every record whose channel is not higher than channel of previous record.
+ * 
+ * @param records records, at most LOG_BLOCK_MAX_RECORDS
+ * @param count count of records, at least one
+ * @param block output buffer of LOG_BLOCK_MAX_SIZE bytes
+ * 
+ * @return uint16_t length of block
+ */
+uint16_t log_encode_block(const log_record_t *records, uint16_t count, uint8_t *block) {
+    log_block_header_t header = {
+        .base_timestamp = records[0].timestamp,
+        .period = 0,
+        .count = count,
+        .flags = LOG_BLOCK_FIXED_PERIOD,
+    };
+    int16_t last_temperature[CHANNEL_COUNT_MAX] = {0};
+    uint32_t sample = 0;
+    size_t len = sizeof(log_block_header_t);
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (records[i].channel != 0) {
+            header.flags |= LOG_BLOCK_CHANNELS;
+        }
+
+        if (i > 0 && records[i].channel <= records[i - 1].channel) {
+            ++sample;
+            if (sample == 1) {
+                int64_t period = (int64_t)records[i].timestamp - header.base_timestamp;
+                if (period <= 0 || period > UINT16_MAX) {
+                    header.flags &= ~LOG_BLOCK_FIXED_PERIOD;
+                }
+                header.period = period;
+            }
+        }
+
+        if ((int64_t)records[i].timestamp != (int64_t)header.base_timestamp + (int64_t)sample * header.period) {
+            header.flags &= ~LOG_BLOCK_FIXED_PERIOD;
+        }
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (!(header.flags & LOG_BLOCK_FIXED_PERIOD)) {
+            uint32_t previous = i > 0 ? records[i - 1].timestamp : header.base_timestamp;
+            len += varint_encode(block + len, ZIGZAG_ENCODE((int32_t)(records[i].timestamp - previous)));
+        }
+
+        if (header.flags & LOG_BLOCK_CHANNELS) {
+            block[len++] = records[i].channel;
+        }
+
+        uint8_t channel = records[i].channel < CHANNEL_COUNT_MAX ? records[i].channel : 0;
+        len += varint_encode(block + len, ZIGZAG_ENCODE(records[i].temperature - last_temperature[channel]));
+        last_temperature[channel] = records[i].temperature;
+    }
+
+    if (!(header.flags & LOG_BLOCK_FIXED_PERIOD)) {
+        header.period = 0;
+    }
+    header.length = len;
+    memcpy(block, &header, sizeof(header));
+    header.check = log_block_check(block, len);
+    memcpy(block, &header, sizeof(header));
+
+    return len;
+}
+
+/**
+ * @brief Function for starting decoding of block.
+ * 
+ * @param decoder decoder
+ * @param block block with valid check
+ */
+void log_decoder_init(log_block_decoder_t *decoder, const uint8_t *block) {
+    memcpy(&decoder->header, block, sizeof(log_block_header_t));
+    decoder->data = block + sizeof(log_block_header_t);
+    decoder->end = block + decoder->header.length;
+    decoder->index = 0;
+    decoder->sample = 0;
+    decoder->last.timestamp = decoder->header.base_timestamp;
+    decoder->last.channel = 0;
+    memset(decoder->last_temperature, 0, sizeof(decoder->last_temperature));
+}
+
+/**
+ * @brief Function for decoding next record of block.
+ * 
+ * @param decoder decoder
+ * @param record output record
+ * 
+ * @return bool false at end of block or if block is damaged
+ */
+bool log_decoder_next(log_block_decoder_t *decoder, log_record_t *record) {
+    uint32_t value;
+
+    if (decoder->index >= decoder->header.count) {
+        return false;
+    }
+
+    if (!(decoder->header.flags & LOG_BLOCK_FIXED_PERIOD)) {
+        if (!varint_decode(&decoder->data, decoder->end, &value)) {
+            return false;
+        }
+        record->timestamp = decoder->last.timestamp + ZIGZAG_DECODE(value);
+    }
+
+    record->channel = 0;
+    if (decoder->header.flags & LOG_BLOCK_CHANNELS) {
+        if (decoder->data >= decoder->end) {
+            return false;
+        }
+        record->channel = *decoder->data++;
+    }
+
+    if (decoder->header.flags & LOG_BLOCK_FIXED_PERIOD) {
+        if (decoder->index > 0 && record->channel <= decoder->last.channel) {
+            ++decoder->sample;
+        }
+        record->timestamp = decoder->header.base_timestamp + decoder->sample * decoder->header.period;
+    }
+
+    if (!varint_decode(&decoder->data, decoder->end, &value)) {
+        return false;
+    }
+    uint8_t channel = record->channel < CHANNEL_COUNT_MAX ? record->channel : 0;
+    record->temperature = decoder->last_temperature[channel] + ZIGZAG_DECODE(value);
+    decoder->last_temperature[channel] = record->temperature;
+
+    decoder->last = *record;
+    ++decoder->index;
+
+    return true;
+}
+
+/************************ RESPONSE WRITER ************************/
+
+/**
+ * @brief Function for initialization of response writer.
+ *        Response is sent in chunks from fixed buffer, nothing is allocated.
+ * 
+ * @param writer writer
+ * @param send sink of chunks
+ * @param ctx context of sink
+ */
+void writer_open(response_writer_t *writer, writer_send_t send, void *ctx) {
+    writer->send = send;
+    writer->ctx = ctx;
+    writer->len = 0;
+    writer->err = ESP_OK;
+}
+
+/**
+ * @brief Function for sending buffered data as one chunk.
+ * 
+ * @param writer writer
+ */
+void writer_flush(response_writer_t *writer) {
+    if (writer->len > 0 && writer->err == ESP_OK) {
+        writer->err = writer->send(writer->ctx, writer->buffer, writer->len);
+    }
+    writer->len = 0;
+}
+
+/**
+ * @brief Function for writing data to response.
+ * 
+ * @param writer writer
+ * @param data data
+ * @param len length of data
+ */
+void writer_write(response_writer_t *writer, const void *data, size_t len) {
+    const char *bytes = data;
+
+    while (len > 0) {
+        if (writer->len == RESPONSE_CHUNK_SIZE) {
+            writer_flush(writer);
+        }
+
+        size_t count = RESPONSE_CHUNK_SIZE - writer->len;
+        if (count > len) {
+            count = len;
+        }
+
+        memcpy(writer->buffer + writer->len, bytes, count);
+        writer->len += count;
+        bytes += count;
+        len -= count;
+    }
+}
+
+/**
+ * @brief Function for writing formatted string to response.
+ * 
+ * @param writer writer
+ * @param format printf format, must not contain floating point conversions
+ */
+void writer_printf(response_writer_t *writer, const char *format, ...) {
+    va_list args;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t space = RESPONSE_CHUNK_SIZE - writer->len;
+
+        va_start(args, format);
+        int len = vsnprintf(writer->buffer + writer->len, space, format, args);
+        va_end(args);
+
+        if (len < 0) {
+            return;
+        }
+
+        if ((size_t)len < space) {
+            writer->len += len;
+            return;
+        }
+
+        // string does not fit into rest of buffer -> flush and try again with empty buffer
+        writer_flush(writer);
+    }
+
+    printf("Error - writer_printf(): string longer than %d bytes dropped\n", RESPONSE_CHUNK_SIZE);
+}
+
+/**
+ * @brief Function for writing centi-degrees as decimal number with two decimal places.
+ * 
+ * @param writer writer
+ * @param value value in centi-degrees
+ */
+void writer_centi(response_writer_t *writer, int32_t value) {
+    writer_printf(writer, "%s%ld.%02ld", value < 0 ? "-" : "", (long)(abs(value) / 100), (long)(abs(value) % 100));
+}
+
+/**
+ * @brief Function for writing fixed-point number as decimal number.
+ * 
+ * @param writer writer
+ * @param value value in units of 10^-decimals
+ * @param decimals count of decimal places, at most 9
+ */
+void writer_fixed(response_writer_t *writer, int64_t value, uint8_t decimals) {
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    uint64_t scale = 1;
+
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+
+    writer_printf(writer, "%s%llu", value < 0 ? "-" : "", (unsigned long long)(magnitude / scale));
+    if (decimals > 0) {
+        writer_printf(writer, ".%0*llu", decimals, (unsigned long long)(magnitude % scale));
+    }
+}
+
+/**
+ * @brief Function for writing string as quoted json string.
+ *        Quote, backslash and control characters are escaped, other bytes are copied, so utf-8 is kept.
+ * 
+ * @param writer writer
+ * @param value string
+ */
+void writer_json_string(response_writer_t *writer, const char *value) {
+    const char *start = value;
+
+    writer_write(writer, "\"", 1);
+    for (; *value != '\0'; value++) {
+        unsigned char c = *value;
+        if (c != '"' && c != '\\' && c >= 0x20) {
+            continue;
+        }
+
+        // unescaped run before character
+        writer_write(writer, start, value - start);
+        start = value + 1;
+
+        if (c == '"' || c == '\\') {
+            writer_printf(writer, "\\%c", c);
+        } else if (c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') {
+            writer_printf(writer, "\\%c", c == '\b' ? 'b' : c == '\f' ? 'f' : c == '\n' ? 'n' : c == '\r' ? 'r' : 't');
+        } else {
+            writer_printf(writer, "\\u%04x", c);
+        }
+    }
+    writer_write(writer, start, value - start);
+    writer_write(writer, "\"", 1);
+}
+
+/**
+ * @brief Function for finishing response, sends rest of buffer and terminating chunk.
+ * 
+ * @param writer writer
+ * 
+ * @return esp_err_t first error of send
+ */
+esp_err_t writer_finish(response_writer_t *writer) {
+    writer_flush(writer);
+
+    if (writer->err == ESP_OK) {
+        writer->err = writer->send(writer->ctx, NULL, 0);
+    }
+
+    return writer->err;
+}
+
+/************************ BODY PARSER ************************/
+
+// states of form
+#define FORM_KEY 0 // key is read
+#define FORM_VALUE 1 // value is read
+
+// states of json
+#define JSON_START 0 // before opening brace
+#define JSON_FIRST_KEY 1 // before first key or closing brace of empty object
+#define JSON_KEY 2 // before key after comma
+#define JSON_KEY_STRING 3 // inside key
+#define JSON_COLON 4 // after key
+#define JSON_VALUE 5 // before value
+#define JSON_VALUE_STRING 6 // inside string value
+#define JSON_VALUE_LITERAL 7 // inside number or literal
+#define JSON_AFTER_VALUE 8 // after value
+#define JSON_END 9 // after closing brace
+
+/**
+ * @brief Function for initialization of body parser, nothing is allocated.
+ * 
+ * @param parser parser
+ * @param format PARSER_FORMAT_FORM or PARSER_FORMAT_JSON
+ * @param field callback called for every complete field
+ * @param ctx context of callback
+ */
+void parser_init(body_parser_t *parser, uint8_t format, parser_field_t field, void *ctx) {
+    memset(parser, 0, sizeof(*parser));
+    parser->format = format;
+    parser->state = format == PARSER_FORMAT_JSON ? JSON_START : FORM_KEY;
+    parser->in_key = true;
+    parser->field = field;
+    parser->ctx = ctx;
+}
+
+/**
+ * @brief Function for appending character to key or value.
+ * 
+ * @param parser parser
+ * @param c character
+ */
+static void parser_append(body_parser_t *parser, char c) {
+    if (parser->in_key) {
+        if (parser->key_len >= PARSER_KEY_MAX) {
+            parser->error = PARSER_ERROR_TOO_LONG;
+            return;
+        }
+        parser->key[parser->key_len++] = c;
+    } else {
+        if (parser->value_len >= PARSER_VALUE_MAX) {
+            parser->error = PARSER_ERROR_TOO_LONG;
+            return;
+        }
+        parser->value[parser->value_len++] = c;
+    }
+}
+
+/**
+ * @brief Function for passing complete field to callback and starting next field.
+ * 
+ * @param parser parser
+ */
+static void parser_emit(body_parser_t *parser) {
+    parser->key[parser->key_len] = '\0';
+    parser->value[parser->value_len] = '\0';
+
+    if (!parser->field(parser->ctx, parser->key, parser->value)) {
+        parser->error = PARSER_ERROR_FIELD; // key is kept for error message
+        return;
+    }
+
+    ++parser->fields;
+    parser->key_len = 0;
+    parser->value_len = 0;
+    parser->in_key = true;
+}
+
+/**
+ * @brief Function for getting value of hex digit.
+ * 
+ * @param c character
+ * 
+ * @return int value of digit, -1 if character is not hex digit
+ */
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Function for parsing one character of form.
+ * 
+ * @param parser parser
+ * @param c character
+ */
+static void parser_form(body_parser_t *parser, char c) {
+    if (parser->escape > 0) { // percent escape
+        int digit = hex_digit(c);
+        if (digit < 0) {
+            parser->error = PARSER_ERROR_SYNTAX;
+            return;
+        }
+        parser->code = (parser->code << 4) | digit;
+        if (--parser->escape == 0) {
+            parser_append(parser, parser->code);
+        }
+        return;
+    }
+
+    if (c == '&') {
+        if (parser->key_len > 0 || parser->value_len > 0) {
+            parser_emit(parser);
+        }
+        parser->state = FORM_KEY;
+    } else if (c == '=' && parser->state == FORM_KEY) {
+        parser->state = FORM_VALUE;
+        parser->in_key = false;
+    } else if (c == '%') {
+        parser->escape = 2;
+        parser->code = 0;
+    } else if (c == '+') {
+        parser_append(parser, ' ');
+    } else if (c == '\r' || c == '\n') {
+        // trailing line break of body written by hand
+    } else {
+        parser_append(parser, c);
+    }
+}
+
+/**
+ * @brief Function for appending code point of json \u escape as utf-8.
+ * 
+ * @param parser parser
+ * @param code code point
+ */
+static void parser_append_utf8(body_parser_t *parser, uint16_t code) {
+    if (code >= 0xD800 && code <= 0xDFFF) { // surrogate pairs are not supported
+        parser->error = PARSER_ERROR_SYNTAX;
+    } else if (code < 0x80) {
+        parser_append(parser, code);
+    } else if (code < 0x800) {
+        parser_append(parser, 0xC0 | (code >> 6));
+        parser_append(parser, 0x80 | (code & 0x3F));
+    } else {
+        parser_append(parser, 0xE0 | (code >> 12));
+        parser_append(parser, 0x80 | ((code >> 6) & 0x3F));
+        parser_append(parser, 0x80 | (code & 0x3F));
+    }
+}
+
+/**
+ * @brief Function for parsing one character inside json string.
+ * 
+ * @param parser parser
+ * @param c character
+ * 
+ * @return bool true at closing quote
+ */
+static bool parser_json_string(body_parser_t *parser, char c) {
+    if (parser->escape == 5) { // character after backslash
+        const char *escapes = "\"\"\\\\//b\bf\fn\nr\rt\t";
+        parser->escape = 0;
+        if (c == 'u') {
+            parser->escape = 4;
+            parser->code = 0;
+            return false;
+        }
+        for (const char *e = escapes; *e != '\0'; e += 2) {
+            if (*e == c) {
+                parser_append(parser, e[1]);
+                return false;
+            }
+        }
+        parser->error = PARSER_ERROR_SYNTAX;
+        return false;
+    }
+
+    if (parser->escape > 0) { // hex digits of \u escape
+        int digit = hex_digit(c);
+        if (digit < 0) {
+            parser->error = PARSER_ERROR_SYNTAX;
+            return false;
+        }
+        parser->code = (parser->code << 4) | digit;
+        if (--parser->escape == 0) {
+            parser_append_utf8(parser, parser->code);
+        }
+        return false;
+    }
+
+    if (c == '"') {
+        return true;
+    }
+    if (c == '\\') {
+        parser->escape = 5;
+    } else if ((unsigned char)c < 0x20) { // control characters must be escaped
+        parser->error = PARSER_ERROR_SYNTAX;
+    } else {
+        parser_append(parser, c);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Function for parsing one character of json.
+ * 
+ * @param parser parser
+ * @param c character
+ */
+static void parser_json(body_parser_t *parser, char c) {
+    bool space = c == ' ' || c == '\t' || c == '\r' || c == '\n';
+
+    switch (parser->state) {
+        case JSON_START:
+            if (c == '{') {
+                parser->state = JSON_FIRST_KEY;
+            } else if (!space) {
+                parser->error = PARSER_ERROR_SYNTAX;
+            }
+            break;
+
+        case JSON_FIRST_KEY:
+        case JSON_KEY:
+            if (c == '"') {
+                parser->state = JSON_KEY_STRING;
+                parser->in_key = true;
+            } else if (c == '}' && parser->state == JSON_FIRST_KEY) {
+                parser->state = JSON_END;
+            } else if (!space) {
+                parser->error = PARSER_ERROR_SYNTAX;
+            }
+            break;
+
+        case JSON_KEY_STRING:
+            if (parser_json_string(parser, c)) {
+                parser->state = JSON_COLON;
+            }
+            break;
+
+        case JSON_COLON:
+            if (c == ':') {
+                parser->state = JSON_VALUE;
+                parser->in_key = false;
+            } else if (!space) {
+                parser->error = PARSER_ERROR_SYNTAX;
+            }
+            break;
+
+        case JSON_VALUE:
+            if (c == '"') {
+                parser->state = JSON_VALUE_STRING;
+            } else if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-') {
+                parser->state = JSON_VALUE_LITERAL;
+                parser_append(parser, c);
+            } else if (!space) { // nested objects and arrays are not supported
+                parser->error = PARSER_ERROR_SYNTAX;
+            }
+            break;
+
+        case JSON_VALUE_STRING:
+            if (parser_json_string(parser, c)) {
+                parser_emit(parser);
+                parser->state = JSON_AFTER_VALUE;
+            }
+            break;
+
+        case JSON_VALUE_LITERAL:
+            if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '+' || c == '.') {
+                parser_append(parser, c);
+                break;
+            }
+            parser_emit(parser);
+            parser->state = JSON_AFTER_VALUE; // character which ends literal is handled as after value
+            // fall through
+        case JSON_AFTER_VALUE:
+            if (parser->error != PARSER_OK) {
+                break;
+            }
+            if (c == ',') {
+                parser->state = JSON_KEY;
+            } else if (c == '}') {
+                parser->state = JSON_END;
+            } else if (!space) {
+                parser->error = PARSER_ERROR_SYNTAX;
+            }
+            break;
+
+        case JSON_END:
+            if (!space) {
+                parser->error = PARSER_ERROR_SYNTAX;
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Function for parsing next chunk of body, chunks may split body at any character.
+ * 
+ * @param parser parser
+ * @param data chunk
+ * @param len length of chunk
+ * 
+ * @return uint8_t PARSER_OK or first error
+ */
+uint8_t parser_feed(body_parser_t *parser, const char *data, size_t len) {
+    for (size_t i = 0; i < len && parser->error == PARSER_OK; i++) {
+        if (data[i] == '\0') { // keys and values are passed as strings
+            parser->error = PARSER_ERROR_SYNTAX;
+        } else if (parser->format == PARSER_FORMAT_JSON) {
+            parser_json(parser, data[i]);
+        } else {
+            parser_form(parser, data[i]);
+        }
+    }
+
+    return parser->error;
+}
+
+/**
+ * @brief Function for finishing body, last form field is passed to callback.
+ * 
+ * @param parser parser
+ * 
+ * @return uint8_t PARSER_OK or first error
+ */
+uint8_t parser_finish(body_parser_t *parser) {
+    if (parser->error != PARSER_OK) {
+        return parser->error;
+    }
+
+    if (parser->format == PARSER_FORMAT_JSON) {
+        if (parser->state != JSON_END) {
+            parser->error = PARSER_ERROR_SYNTAX;
+        }
+    } else if (parser->escape > 0) {
+        parser->error = PARSER_ERROR_SYNTAX;
+    } else if (parser->key_len > 0 || parser->value_len > 0) {
+        parser_emit(parser);
+    }
+
+    return parser->error;
+}
+
+/************************ ALERT RULES ************************/
+
+/**
+ * @brief Function for evaluating alert rule with new value of its channel, constant time per call.
+ *        Condition has to differ from state of alert for duration of rule before alert is raised or released,
+ *        raised alert stays raised within hysteresis band of limit.
+ * 
+ * @param rule rule
+ * @param state state of rule, updated
+ * @param value value of channel, NAN if channel has no conversions
+ * @param time_us monotonic time of value
+ * 
+ * @return bool true if alert was raised or released
+ */
+bool alert_evaluate(const alert_rule_t *rule, alert_state_t *state, double value, int64_t time_us) {
+    bool condition;
+
+    if (!state->has_value) {
+        state->has_value = true;
+        state->last_valid_us = time_us;
+        state->reference_us = time_us;
+        state->reference_value = value;
+        state->rate = 0.0;
+    }
+
+    if (isnan(value)) {
+        if (rule->type != ALERT_STALE) { // no new information for other rules
+            return false;
+        }
+        condition = time_us - state->last_valid_us >= (int64_t)(rule->limit * 1000000.0);
+    } else {
+        state->last_valid_us = time_us;
+
+        // rate is measured over window of at least ALERT_RATE_WINDOW_US, so noise of single samples is not amplified
+        if (isnan(state->reference_value)) {
+            state->reference_value = value;
+            state->reference_us = time_us;
+        } else if (time_us - state->reference_us >= ALERT_RATE_WINDOW_US) {
+            state->rate = (value - state->reference_value) * 60000000.0 / (time_us - state->reference_us);
+            state->reference_value = value;
+            state->reference_us = time_us;
+        }
+
+        switch (rule->type) {
+            case ALERT_ABOVE:
+                condition = value > rule->limit || (state->active && value > rule->limit - rule->hysteresis);
+                break;
+
+            case ALERT_BELOW:
+                condition = value < rule->limit || (state->active && value < rule->limit + rule->hysteresis);
+                break;
+
+            case ALERT_RATE:
+                condition = fabs(state->rate) > rule->limit || (state->active && fabs(state->rate) > rule->limit - rule->hysteresis);
+                break;
+
+            default:
+                condition = false;
+                break;
+        }
+    }
+
+    if (condition == state->active) {
+        state->pending = false;
+        return false;
+    }
+
+    if (!state->pending) {
+        state->pending = true;
+        state->pending_since_us = time_us;
+    }
+
+    if (time_us - state->pending_since_us < (int64_t)rule->duration_s * 1000000) {
+        return false;
+    }
+
+    state->active = condition;
+    state->pending = false;
+    return true;
+}
+
+/*** End of pipeline.c ***/
@@ -0,0 +1,166 @@
+/*
+ * @file pipeline.h
+ * @brief Hardware independent part of measuring, storing and serving temperature:
+ *        conversion, threshold, record encoding and response writer.
+ *        Nothing here touches drivers, so it compiles for ESP-IDF linux target as well.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/************************ TEMPERATURE CONVERSION ************************/
+
+#define CHANNEL_COUNT_MAX 8 // count of ADC1 channels, ADC2 can not be used together with wifi
+#define ADC_FRACTION_BITS 4 // fraction bits of decimated raw value
+#define LUT_SIZE 4096 // entries of every table, temperature_lut is indexed by millivolt, calibrated tables by 12-bit raw code
+
+// sensor transfer function, temperature in degrees from millivolts
+#define TEMPERATURE_FROM_MV(mV) ((8.194 - __builtin_sqrt(8.194 * 8.194 + 4 * 0.00262 * (1324 - (double)(mV)))) / (2 * -0.00262) + 40)
+
+extern const int16_t temperature_lut[LUT_SIZE]; // temperature in centi-degrees for every millivolt
+
+double lut_convert(const int16_t *lut, uint32_t raw, bool interpolate);
+uint32_t lut_find_raw(const int16_t *lut, double value);
+bool threshold_evaluate(double value, double threshold, double hysteresis, bool overcome);
+
+/************************ RECORD ENCODING ************************/
+
+#define LOG_BLOCK_MAX_RECORDS 64 // maximal count of records in one block
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp; // time of sample in seconds
+    int16_t temperature; // temperature in centi-degrees
+    uint8_t channel; // index of channel in channel table
+} log_record_t;
+
+// block of records, one block is written per flush of staging buffer,
+// records are zigzag varint deltas of temperature of same channel
+// and zigzag varint deltas of timestamp unless LOG_BLOCK_FIXED_PERIOD is set
+typedef struct __attribute__((packed)) {
+    uint16_t length; // length of block including header, LOG_BLOCK_FREE where free space of sector starts
+    uint16_t check; // Fletcher-16 of length and rest of block for detection of torn writes
+    uint32_t base_timestamp; // timestamp of first record
+    uint16_t period; // seconds between samples if LOG_BLOCK_FIXED_PERIOD is set
+    uint8_t count; // count of records
+    uint8_t flags; // LOG_BLOCK_* flags
+} log_block_header_t;
+
+#define LOG_BLOCK_FIXED_PERIOD 0x01 // timestamps are not stored, sample k of block has base_timestamp + k * period
+#define LOG_BLOCK_CHANNELS 0x02 // every record has channel byte, all records are of first channel otherwise
+#define LOG_RECORD_MAX_SIZE 9 // encoded record, 5 bytes of timestamp delta, channel and 3 bytes of temperature delta
+#define LOG_BLOCK_MAX_SIZE (sizeof(log_block_header_t) + LOG_BLOCK_MAX_RECORDS * LOG_RECORD_MAX_SIZE) // largest block
+#define ZIGZAG_ENCODE(value) (((uint32_t)(value) << 1) ^ (uint32_t)((int32_t)(value) >> 31)) // signed to unsigned, small magnitudes stay small
+#define ZIGZAG_DECODE(value) ((int32_t)((value) >> 1) ^ -(int32_t)((value) & 1)) // inverse of ZIGZAG_ENCODE
+
+typedef struct {
+    const uint8_t *data; // next encoded record
+    const uint8_t *end; // end of block
+    log_block_header_t header; // header of block
+    uint16_t index; // count of decoded records
+    uint32_t sample; // index of sample of last record, used with LOG_BLOCK_FIXED_PERIOD
+    log_record_t last; // last decoded record
+    int16_t last_temperature[CHANNEL_COUNT_MAX]; // last temperature of every channel
+} log_block_decoder_t;
+
+size_t varint_encode(uint8_t *out, uint32_t value);
+bool varint_decode(const uint8_t **data, const uint8_t *end, uint32_t *value);
+uint16_t log_block_check(const uint8_t *block, uint16_t length);
+uint16_t log_encode_block(const log_record_t *records, uint16_t count, uint8_t *block);
+void log_decoder_init(log_block_decoder_t *decoder, const uint8_t *block);
+bool log_decoder_next(log_block_decoder_t *decoder, log_record_t *record);
+
+/************************ RESPONSE WRITER ************************/
+
+#define RESPONSE_CHUNK_SIZE 512 // size of response buffer sent as one chunk
+
+// sink of response, called with NULL data and zero length once at end of response
+typedef esp_err_t (*writer_send_t)(void *ctx, const char *data, size_t len);
+
+typedef struct {
+    writer_send_t send; // sink of chunks
+    void *ctx; // context of sink, request which is answered
+    char buffer[RESPONSE_CHUNK_SIZE]; // data waiting for send
+    size_t len; // count of bytes in buffer
+    esp_err_t err; // first error of send, further data is dropped
+} response_writer_t;
+
+void writer_open(response_writer_t *writer, writer_send_t send, void *ctx);
+void writer_flush(response_writer_t *writer);
+void writer_write(response_writer_t *writer, const void *data, size_t len);
+void writer_printf(response_writer_t *writer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void writer_centi(response_writer_t *writer, int32_t value);
+void writer_fixed(response_writer_t *writer, int64_t value, uint8_t decimals);
+void writer_json_string(response_writer_t *writer, const char *value);
+esp_err_t writer_finish(response_writer_t *writer);
+
+/************************ BODY PARSER ************************/
+
+#define PARSER_KEY_MAX 32 // maximal length of key
+#define PARSER_VALUE_MAX 128 // maximal length of value
+#define PARSER_FORMAT_FORM 0 // key=value pairs separated by &, url encoded
+#define PARSER_FORMAT_JSON 1 // flat json object, values are strings, numbers or literals
+
+#define PARSER_OK 0 // body is valid so far
+#define PARSER_ERROR_SYNTAX 1 // body is malformed or json is nested
+#define PARSER_ERROR_TOO_LONG 2 // key or value is longer than its buffer
+#define PARSER_ERROR_FIELD 3 // field was rejected by callback
+
+// field callback, returns false if key is unknown or value is invalid
+typedef bool (*parser_field_t)(void *ctx, const char *key, const char *value);
+
+typedef struct {
+    uint8_t format; // PARSER_FORMAT_*
+    uint8_t state; // state of format
+    uint8_t error; // PARSER_OK or first error, further data is ignored
+    uint8_t escape; // count of pending hex digits of escape, 0 if there is no escape
+    uint16_t code; // value of pending escape
+    bool in_key; // characters belong to key, to value otherwise
+    parser_field_t field; // field callback
+    void *ctx; // context of field callback
+    char key[PARSER_KEY_MAX + 1]; // key of current field, also key of rejected field
+    size_t key_len; // length of key
+    char value[PARSER_VALUE_MAX + 1]; // value of current field
+    size_t value_len; // length of value
+    uint16_t fields; // count of accepted fields
+} body_parser_t;
+
+void parser_init(body_parser_t *parser, uint8_t format, parser_field_t field, void *ctx);
+uint8_t parser_feed(body_parser_t *parser, const char *data, size_t len);
+uint8_t parser_finish(body_parser_t *parser);
+
+/************************ ALERT RULES ************************/
+
+#define ALERT_OFF 0 // rule is not evaluated
+#define ALERT_ABOVE 1 // value is above limit in degrees
+#define ALERT_BELOW 2 // value is below limit in degrees
+#define ALERT_RATE 3 // magnitude of change is above limit in degrees per minute
+#define ALERT_STALE 4 // channel has no valid value for limit seconds
+#define ALERT_RATE_WINDOW_US 60000000LL // shortest time over which rate of change is measured
+
+typedef struct {
+    uint8_t type; // ALERT_*
+    uint8_t channel; // index of channel
+    double limit; // degrees, degrees per minute or seconds, by type
+    double hysteresis; // width of band where raised alert stays raised, not used by ALERT_STALE
+    uint32_t duration_s; // time condition has to hold before alert is raised or released
+} alert_rule_t;
+
+typedef struct {
+    bool active; // alert is raised
+    bool pending; // condition differs from active since pending_since_us
+    int64_t pending_since_us; // time when condition started to differ from active
+    bool has_value; // last_valid_us and reference are known
+    int64_t last_valid_us; // time of last valid value
+    double reference_value; // value at start of rate window
+    int64_t reference_us; // start of rate window
+    double rate; // last measured rate in degrees per minute
+} alert_state_t;
+
+bool alert_evaluate(const alert_rule_t *rule, alert_state_t *state, double value, int64_t time_us);
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ * @file bench_pipeline.c
+ * @brief Host benchmark of hardware independent pipeline.
+ *        Reports ns/sample of sample path, bytes written per sample by record log
+ *        and requests/s of response building and request parsing with stub sink.
+ *        Argument scales count of iterations, 1 is short smoke run.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pipeline.h"
+
+#define BENCH_SAMPLES 1000000 // samples of sample path per unit of scale
+#define BENCH_RECORDS 100000 // records of record encoding per unit of scale
+#define BENCH_REQUESTS 2000 // requests of every handler per unit of scale
+#define BENCH_CHANNELS 4 // channels of one sample
+#define BENCH_RULES 8 // alert rules evaluated per sample
+
+volatile double sink_value; // keeps results of benchmarks from being optimized out
+size_t sink_bytes = 0; // bytes received by stub sink
+
+/**
+ * @brief Function for reading monotonic time.
+ *
+ * @return double time in nanoseconds
+ */
+double now_ns() {
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+/**
+ * @brief Function for generating raw value of channel, slow drift with noise of few codes.
+ *
+ * @param i index of sample
+ * @param channel channel
+ *
+ * @return uint32_t raw value with ADC_FRACTION_BITS
+ */
+uint32_t synthetic_raw(uint32_t i, uint8_t channel) {
+    double mV = 1000.0 + 200.0 * channel + 50.0 * sin(i / 5000.0) + (rand() % 5 - 2);
+
+    return (uint32_t)(mV * (1 << ADC_FRACTION_BITS));
+}
+
+/**
+ * @brief Function for discarding chunks of response, stub of httpd_resp_send_chunk.
+ *
+ * @param ctx unused
+ * @param data chunk, NULL at end of response
+ * @param len length of chunk
+ *
+ * @return esp_err_t ESP_OK
+ */
+esp_err_t discard_chunk(void *ctx, const char *data, size_t len) {
+    sink_bytes += len;
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for accepting field of request, stub of settings field callback.
+ *
+ * @param ctx unused
+ * @param key key of field
+ * @param value value of field
+ *
+ * @return bool true
+ */
+bool accept_field(void *ctx, const char *key, const char *value) {
+    sink_value += strtod(value, NULL) + key[0];
+    return true;
+}
+
+/**
+ * @brief Function for measuring sample path: conversion, threshold and alert rules of every channel.
+ *
+ * @param scale scale of iterations
+ */
+void bench_sample_path(uint32_t scale) {
+    static uint32_t raws[4096][BENCH_CHANNELS];
+    alert_rule_t rules[BENCH_RULES];
+    alert_state_t states[BENCH_RULES] = {0};
+    bool overcome[BENCH_CHANNELS] = {0};
+    uint32_t samples = BENCH_SAMPLES * scale;
+
+    for (uint32_t i = 0; i < 4096; i++) {
+        for (uint8_t channel = 0; channel < BENCH_CHANNELS; channel++) {
+            raws[i][channel] = synthetic_raw(i, channel);
+        }
+    }
+    for (uint8_t i = 0; i < BENCH_RULES; i++) {
+        rules[i] = (alert_rule_t){.type = ALERT_ABOVE + i % 4, .channel = i % BENCH_CHANNELS, .limit = i % 4 == 3 ? 60.0 : 25.0, .hysteresis = 0.5, .duration_s = 10};
+    }
+
+    double start = now_ns();
+    for (uint32_t i = 0; i < samples; i++) {
+        double temperature[BENCH_CHANNELS];
+        int64_t time_us = (int64_t)i * 100000;
+
+        for (uint8_t channel = 0; channel < BENCH_CHANNELS; channel++) {
+            temperature[channel] = lut_convert(temperature_lut, raws[i & 4095][channel], true);
+            overcome[channel] = threshold_evaluate(temperature[channel], 25.0, 0.5, overcome[channel]);
+        }
+        for (uint8_t rule = 0; rule < BENCH_RULES; rule++) {
+            alert_evaluate(&rules[rule], &states[rule], temperature[rules[rule].channel], time_us);
+        }
+        sink_value += temperature[0] + overcome[0];
+    }
+    double elapsed = now_ns() - start;
+
+    printf("sample path (%u channels, %u rules)  %8.1f ns/sample\n", BENCH_CHANNELS, BENCH_RULES, elapsed / samples);
+}
+
+/**
+ * @brief Function for measuring record encoding and size of record log per sample.
+ *
+ * @param scale scale of iterations
+ * @param channels count of channels of one sample
+ * @param period seconds between samples
+ */
+void bench_record_encoding(uint32_t scale, uint8_t channels, uint32_t period) {
+    log_record_t records[LOG_BLOCK_MAX_RECORDS];
+    uint8_t block[LOG_BLOCK_MAX_SIZE];
+    uint32_t per_block = LOG_BLOCK_MAX_RECORDS / channels * channels;
+    uint32_t blocks = BENCH_RECORDS * scale / per_block;
+    uint64_t bytes = 0;
+    uint32_t sample = 0;
+    double encode_ns = 0;
+    double decode_ns = 0;
+
+    for (uint32_t b = 0; b < blocks; b++) {
+        for (uint32_t i = 0; i < per_block; i++) {
+            if (i > 0 && i % channels == 0) {
+                ++sample;
+            }
+            uint8_t channel = i % channels;
+            records[i] = (log_record_t){
+                .timestamp = 1700000000 + sample * period,
+                .temperature = (int16_t)lround(lut_convert(temperature_lut, synthetic_raw(sample, channel), true) * 100.0),
+                .channel = channel,
+            };
+        }
+        ++sample;
+
+        double start = now_ns();
+        uint16_t len = log_encode_block(records, per_block, block);
+        encode_ns += now_ns() - start;
+        bytes += len;
+
+        log_block_decoder_t decoder;
+        log_record_t record;
+        start = now_ns();
+        log_decoder_init(&decoder, block);
+        while (log_decoder_next(&decoder, &record)) {
+            sink_value += record.temperature;
+        }
+        decode_ns += now_ns() - start;
+    }
+
+    uint64_t count = (uint64_t)blocks * per_block;
+    printf("record log (%u channels, %lu s period)   %8.2f B/sample %6.2f B/record (raw %zu B), encode %6.1f ns/record, decode %6.1f ns/record\n",
+           channels, (unsigned long)period, (double)bytes / (count / channels), (double)bytes / count, sizeof(log_record_t),
+           encode_ns / count, decode_ns / count);
+}
+
+/**
+ * @brief Function for measuring history response of one block of buckets, as written by /history handler.
+ *
+ * @param scale scale of iterations
+ */
+void bench_history_response(uint32_t scale) {
+    static response_writer_t writer;
+    log_record_t records[LOG_BLOCK_MAX_RECORDS];
+    uint8_t block[LOG_BLOCK_MAX_SIZE];
+    uint32_t requests = BENCH_REQUESTS * scale;
+    uint32_t blocks = 8; // blocks read by one request
+
+    for (uint32_t i = 0; i < LOG_BLOCK_MAX_RECORDS; i++) {
+        records[i] = (log_record_t){.timestamp = 1700000000 + 10 * i, .temperature = 2100 + i % 9, .channel = 0};
+    }
+    log_encode_block(records, LOG_BLOCK_MAX_RECORDS, block);
+
+    sink_bytes = 0;
+    double start = now_ns();
+    for (uint32_t r = 0; r < requests; r++) {
+        writer_open(&writer, discard_chunk, NULL);
+        writer_printf(&writer, "{\"step\":10,\"buckets\":[");
+        for (uint32_t b = 0; b < blocks; b++) {
+            log_block_decoder_t decoder;
+            log_record_t record;
+            log_decoder_init(&decoder, block);
+            while (log_decoder_next(&decoder, &record)) {
+                writer_printf(&writer, "%s[%lu,", b > 0 || decoder.index > 1 ? "," : "", (unsigned long)record.timestamp);
+                writer_centi(&writer, record.temperature);
+                writer_printf(&writer, ",");
+                writer_centi(&writer, record.temperature);
+                writer_printf(&writer, ",");
+                writer_centi(&writer, record.temperature);
+                writer_printf(&writer, ",1]");
+            }
+        }
+        writer_printf(&writer, "]}");
+        writer_finish(&writer);
+    }
+    double elapsed = now_ns() - start;
+
+    printf("history response (%u buckets)         %8.0f requests/s, %lu B/response\n", blocks * LOG_BLOCK_MAX_RECORDS,
+           requests / (elapsed / 1e9), (unsigned long)(sink_bytes / requests));
+}
+
+/**
+ * @brief Function for measuring parsing of settings request, as received by PUT /config handler.
+ *
+ * @param scale scale of iterations
+ * @param format PARSER_FORMAT_*
+ * @param body body of request
+ */
+void bench_settings_request(uint32_t scale, uint8_t format, const char *body) {
+    body_parser_t parser;
+    uint32_t requests = BENCH_REQUESTS * 10 * scale;
+    size_t len = strlen(body);
+
+    double start = now_ns();
+    for (uint32_t r = 0; r < requests; r++) {
+        parser_init(&parser, format, accept_field, NULL);
+        for (size_t i = 0; i < len; i += 64) { // REQUEST_CHUNK_SIZE
+            parser_feed(&parser, body + i, len - i < 64 ? len - i : 64);
+        }
+        if (parser_finish(&parser) != PARSER_OK) {
+            printf("Error - bench_settings_request(): body is invalid\n");
+            return;
+        }
+    }
+    double elapsed = now_ns() - start;
+
+    printf("settings request (%s, %zu B)         %8.0f requests/s\n", format == PARSER_FORMAT_JSON ? "json" : "form", len,
+           requests / (elapsed / 1e9));
+}
+
+int main(int argc, char **argv) {
+    uint32_t scale = argc > 1 ? strtoul(argv[1], NULL, 10) : 10;
+
+    if (scale == 0) {
+        scale = 1;
+    }
+    srand(1);
+
+    bench_sample_path(scale);
+    bench_record_encoding(scale, 1, 10);
+    bench_record_encoding(scale, BENCH_CHANNELS, 10);
+    bench_history_response(scale);
+    bench_settings_request(scale, PARSER_FORMAT_JSON,
+                           "{\"threshold.0\":25.5,\"hysteresis\":0.5,\"input\":\"ewma\",\"period\":1000,\"adaptive\":true,"
+                           "\"min\":200,\"max\":60000,\"ssid\":\"site-17\",\"ntp\":\"pool.ntp.org\",\"uplink_interval\":30000}");
+    bench_settings_request(scale, PARSER_FORMAT_FORM, "threshold=25.5&hysteresis=0.5&period=1000&adaptive=1&ssid=site%2D17");
+
+    return EXIT_SUCCESS;
+}
+
+/*** End of bench_pipeline.c ***/
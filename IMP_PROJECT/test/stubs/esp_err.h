@@ -0,0 +1,19 @@
+/*
+ * @file esp_err.h
+ * @brief Host stub of ESP-IDF error codes used by pipeline.c.
+ */
+
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+typedef int esp_err_t;
+
+#define ESP_OK 0 // no error
+#define ESP_FAIL -1 // generic failure
+#define ESP_ERR_INVALID_ARG 0x102 // invalid argument
+
+static inline const char *esp_err_to_name(esp_err_t code) {
+    return code == ESP_OK ? "ESP_OK" : code == ESP_ERR_INVALID_ARG ? "ESP_ERR_INVALID_ARG" : "ESP_FAIL";
+}
+
+#endif
@@ -0,0 +1,547 @@
+/*
+ * @file test_pipeline.c
+ * @brief Unit tests of hardware independent pipeline, run on host by ctest.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pipeline.h"
+
+uint32_t checks = 0; // count of evaluated checks
+uint32_t failures = 0; // count of failed checks
+
+// check of condition, failure is reported with line and test continues
+#define CHECK(condition) do { \
+    ++checks; \
+    if (!(condition)) { \
+        ++failures; \
+        printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition); \
+    } \
+} while (0)
+
+/************************ TEMPERATURE CONVERSION ************************/
+
+/**
+ * @brief Function for testing that lookup table falls with millivolts and matches transfer function.
+ */
+void test_lut_table() {
+    for (uint32_t mV = 1; mV < LUT_SIZE; mV++) {
+        if (temperature_lut[mV] > temperature_lut[mV - 1]) {
+            CHECK(temperature_lut[mV] <= temperature_lut[mV - 1]);
+            break;
+        }
+    }
+
+    for (uint32_t mV = 0; mV < 2500; mV += 100) {
+        CHECK(fabs(temperature_lut[mV] / 100.0 - TEMPERATURE_FROM_MV(mV)) <= 0.005);
+    }
+}
+
+/**
+ * @brief Function for testing conversion of raw values with and without interpolation.
+ */
+void test_lut_convert() {
+    uint32_t index = 1000;
+    uint32_t raw = index << ADC_FRACTION_BITS;
+    uint32_t half = 1 << (ADC_FRACTION_BITS - 1);
+
+    CHECK(lut_convert(temperature_lut, raw, true) == temperature_lut[index] / 100.0);
+    CHECK(lut_convert(temperature_lut, raw + half, false) == temperature_lut[index] / 100.0);
+
+    double middle = lut_convert(temperature_lut, raw + half, true);
+    double expected = (temperature_lut[index] + (temperature_lut[index + 1] - temperature_lut[index]) / 2) / 100.0;
+    CHECK(fabs(middle - expected) <= 0.01);
+
+    // last code and values above table are clamped to last entry
+    uint32_t last = (LUT_SIZE - 1) << ADC_FRACTION_BITS;
+    CHECK(lut_convert(temperature_lut, last + half, true) == temperature_lut[LUT_SIZE - 1] / 100.0);
+    CHECK(lut_convert(temperature_lut, UINT32_MAX, true) == temperature_lut[LUT_SIZE - 1] / 100.0);
+}
+
+/**
+ * @brief Function for testing search of raw code of temperature.
+ */
+void test_lut_find_raw() {
+    const double values[] = {-20.0, 0.0, 21.37, 50.0, 100.0};
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        int32_t centi = lround(values[i] * 100.0);
+        uint32_t raw = lut_find_raw(temperature_lut, values[i]);
+        CHECK(raw < LUT_SIZE - 1);
+        CHECK(temperature_lut[raw] >= centi);
+        CHECK(temperature_lut[raw + 1] < centi);
+    }
+
+    // temperature above table starts at first code, below table at last
+    CHECK(lut_find_raw(temperature_lut, 1000.0) == 0);
+    CHECK(lut_find_raw(temperature_lut, -1000.0) == LUT_SIZE - 1);
+}
+
+/**
+ * @brief Function for testing threshold hysteresis.
+ */
+void test_threshold_evaluate() {
+    CHECK(threshold_evaluate(25.0, 25.0, 1.0, false));
+    CHECK(!threshold_evaluate(24.5, 25.0, 1.0, false));
+    CHECK(threshold_evaluate(24.5, 25.0, 1.0, true));
+    CHECK(!threshold_evaluate(23.9, 25.0, 1.0, true));
+}
+
+/************************ RECORD ENCODING ************************/
+
+/**
+ * @brief Function for testing varint round trip and truncated varint.
+ */
+void test_varint() {
+    const uint32_t values[] = {0, 1, 127, 128, 16383, 16384, UINT32_MAX};
+    uint8_t buffer[5];
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        size_t len = varint_encode(buffer, values[i]);
+        const uint8_t *data = buffer;
+        uint32_t value = 0;
+        CHECK(varint_decode(&data, buffer + len, &value));
+        CHECK(value == values[i]);
+        CHECK(data == buffer + len);
+    }
+
+    size_t len = varint_encode(buffer, 300);
+    const uint8_t *data = buffer;
+    uint32_t value;
+    CHECK(!varint_decode(&data, buffer + len - 1, &value));
+
+    for (int32_t delta = -3; delta <= 3; delta++) {
+        CHECK(ZIGZAG_DECODE(ZIGZAG_ENCODE(delta)) == delta);
+    }
+    CHECK(ZIGZAG_ENCODE(-1) == 1 && ZIGZAG_ENCODE(1) == 2);
+}
+
+/**
+ * @brief Function for testing Fletcher-16 check, check field of header is skipped.
+ */
+void test_log_block_check() {
+    // Fletcher-16 of "abcde" is 0xC8F0, bytes 2 and 3 hold check and are not summed
+    uint8_t block[] = {'a', 'b', 0x55, 0xAA, 'c', 'd', 'e'};
+
+    CHECK(log_block_check(block, sizeof(block)) == 0xC8F0);
+    block[2] = 0;
+    block[3] = 0;
+    CHECK(log_block_check(block, sizeof(block)) == 0xC8F0);
+    block[6] ^= 1;
+    CHECK(log_block_check(block, sizeof(block)) != 0xC8F0);
+}
+
+/**
+ * @brief Function for encoding records, checking block and comparing decoded records.
+ *
+ * @param records records
+ * @param count count of records
+ * @param flags expected flags of block
+ */
+void check_round_trip(const log_record_t *records, uint16_t count, uint8_t flags) {
+    uint8_t block[LOG_BLOCK_MAX_SIZE];
+    log_block_header_t header;
+    log_block_decoder_t decoder;
+    log_record_t record;
+    uint16_t decoded = 0;
+
+    uint16_t len = log_encode_block(records, count, block);
+    memcpy(&header, block, sizeof(header));
+    CHECK(len <= LOG_BLOCK_MAX_SIZE);
+    CHECK(header.length == len);
+    CHECK(header.count == count);
+    CHECK(header.flags == flags);
+    CHECK(header.check == log_block_check(block, len));
+
+    log_decoder_init(&decoder, block);
+    while (log_decoder_next(&decoder, &record)) {
+        CHECK(decoded < count);
+        if (decoded >= count) {
+            break;
+        }
+        CHECK(record.timestamp == records[decoded].timestamp);
+        CHECK(record.temperature == records[decoded].temperature);
+        CHECK(record.channel == records[decoded].channel);
+        ++decoded;
+    }
+    CHECK(decoded == count);
+}
+
+/**
+ * @brief Function for testing block round trip with fixed period, channels and irregular timestamps.
+ */
+void test_log_block_round_trip() {
+    log_record_t records[LOG_BLOCK_MAX_RECORDS];
+
+    // one channel with fixed period, timestamps are not stored
+    for (uint16_t i = 0; i < LOG_BLOCK_MAX_RECORDS; i++) {
+        records[i] = (log_record_t){.timestamp = 1700000000 + 10 * i, .temperature = 2100 + (i % 7) - 3, .channel = 0};
+    }
+    check_round_trip(records, LOG_BLOCK_MAX_RECORDS, LOG_BLOCK_FIXED_PERIOD);
+
+    // three channels per sample with fixed period
+    for (uint16_t i = 0; i < 63; i++) {
+        records[i] = (log_record_t){.timestamp = 1700000000 + 5 * (i / 3), .temperature = -500 + 1000 * (i % 3) + i, .channel = i % 3};
+    }
+    check_round_trip(records, 63, LOG_BLOCK_FIXED_PERIOD | LOG_BLOCK_CHANNELS);
+
+    // irregular timestamps and extreme temperatures
+    for (uint16_t i = 0; i < 20; i++) {
+        records[i] = (log_record_t){.timestamp = 1700000000 + i * i, .temperature = i % 2 ? INT16_MAX : INT16_MIN, .channel = 0};
+    }
+    check_round_trip(records, 20, 0);
+
+    // single record
+    check_round_trip(records, 1, LOG_BLOCK_FIXED_PERIOD);
+}
+
+/**
+ * @brief Function for testing that damaged block stops decoder.
+ */
+void test_log_decoder_truncated() {
+    log_record_t records[8];
+    uint8_t block[LOG_BLOCK_MAX_SIZE];
+    log_block_decoder_t decoder;
+    log_record_t record;
+    log_block_header_t header;
+    uint16_t decoded = 0;
+
+    for (uint16_t i = 0; i < 8; i++) {
+        records[i] = (log_record_t){.timestamp = 100 + i * i, .temperature = 1000 * i, .channel = 0};
+    }
+    uint16_t len = log_encode_block(records, 8, block);
+
+    memcpy(&header, block, sizeof(header));
+    header.length = len - 1;
+    memcpy(block, &header, sizeof(header));
+
+    log_decoder_init(&decoder, block);
+    while (log_decoder_next(&decoder, &record)) {
+        ++decoded;
+    }
+    CHECK(decoded < 8);
+}
+
+/************************ RESPONSE WRITER ************************/
+
+typedef struct {
+    char data[4096]; // collected response
+    size_t len; // length of response
+    uint32_t chunks; // count of chunks
+    bool finished; // terminating chunk was sent
+} collector_t;
+
+/**
+ * @brief Function for collecting chunks of response in memory, stub of httpd_resp_send_chunk.
+ *
+ * @param ctx collector
+ * @param data chunk, NULL at end of response
+ * @param len length of chunk
+ *
+ * @return esp_err_t ESP_FAIL if collector is full
+ */
+esp_err_t collect_chunk(void *ctx, const char *data, size_t len) {
+    collector_t *collector = ctx;
+
+    if (data == NULL) {
+        collector->finished = true;
+        return ESP_OK;
+    }
+    if (collector->len + len >= sizeof(collector->data)) {
+        return ESP_FAIL;
+    }
+
+    memcpy(collector->data + collector->len, data, len);
+    collector->len += len;
+    collector->data[collector->len] = '\0';
+    ++collector->chunks;
+    return ESP_OK;
+}
+
+/**
+ * @brief Function for testing chunking and number formatting of writer.
+ */
+void test_writer() {
+    static collector_t collector;
+    static response_writer_t writer;
+    char expected[4096];
+    size_t len = 0;
+
+    writer_open(&writer, collect_chunk, &collector);
+    for (int i = 0; i < 100; i++) {
+        writer_printf(&writer, "%d,", i * 1000);
+        len += snprintf(expected + len, sizeof(expected) - len, "%d,", i * 1000);
+    }
+    writer_centi(&writer, -5);
+    writer_printf(&writer, ",");
+    writer_centi(&writer, 2137);
+    writer_printf(&writer, ",");
+    writer_fixed(&writer, -1000001, 6);
+    writer_printf(&writer, ",");
+    writer_fixed(&writer, 42, 0);
+    len += snprintf(expected + len, sizeof(expected) - len, "-0.05,21.37,-1.000001,42");
+
+    CHECK(writer_finish(&writer) == ESP_OK);
+    CHECK(collector.finished);
+    CHECK(collector.chunks > 1);
+    CHECK(collector.len == len);
+    CHECK(strcmp(collector.data, expected) == 0);
+}
+
+/**
+ * @brief Function for testing json string escaping, escaped string is parsed back by body parser.
+ */
+void test_writer_json_string() {
+    static collector_t collector;
+    static response_writer_t writer;
+
+    writer_open(&writer, collect_chunk, &collector);
+    writer_json_string(&writer, "a\"b\\c\n\t\x01\xc3\xa9");
+    writer_printf(&writer, ",");
+    writer_json_string(&writer, "");
+    CHECK(writer_finish(&writer) == ESP_OK);
+    CHECK(strcmp(collector.data, "\"a\\\"b\\\\c\\n\\t\\u0001\xc3\xa9\",\"\"") == 0);
+
+    // string longer than buffer of writer
+    char value[RESPONSE_CHUNK_SIZE * 3];
+    memset(value, '"', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+    memset(&collector, 0, sizeof(collector));
+    writer_open(&writer, collect_chunk, &collector);
+    writer_json_string(&writer, value);
+    CHECK(writer_finish(&writer) == ESP_OK);
+    CHECK(collector.len == 2 * (sizeof(value) - 1) + 2);
+}
+
+/************************ BODY PARSER ************************/
+
+typedef struct {
+    char fields[512]; // received fields as key=value lines
+    size_t len; // length of fields
+    const char *reject; // key which is rejected, NULL if all keys are accepted
+} fields_t;
+
+/**
+ * @brief Function for recording field, stub of settings field callback.
+ *
+ * @param ctx fields
+ * @param key key of field
+ * @param value value of field
+ *
+ * @return bool false for rejected key
+ */
+bool record_field(void *ctx, const char *key, const char *value) {
+    fields_t *fields = ctx;
+
+    if (fields->reject != NULL && strcmp(key, fields->reject) == 0) {
+        return false;
+    }
+    fields->len += snprintf(fields->fields + fields->len, sizeof(fields->fields) - fields->len, "%s=%s\n", key, value);
+    return true;
+}
+
+/**
+ * @brief Function for parsing body in chunks of given size.
+ *
+ * @param format PARSER_FORMAT_*
+ * @param body body
+ * @param chunk size of chunk
+ * @param fields output fields
+ *
+ * @return uint8_t result of parser
+ */
+uint8_t parse(uint8_t format, const char *body, size_t chunk, fields_t *fields) {
+    body_parser_t parser;
+    size_t len = strlen(body);
+
+    fields->len = 0;
+    fields->fields[0] = '\0';
+    parser_init(&parser, format, record_field, fields);
+    for (size_t i = 0; i < len; i += chunk) {
+        parser_feed(&parser, body + i, len - i < chunk ? len - i : chunk);
+    }
+
+    return parser_finish(&parser);
+}
+
+/**
+ * @brief Function for testing form bodies with escapes, split at every possible position.
+ */
+void test_parser_form() {
+    fields_t fields = {0};
+
+    for (size_t chunk = 1; chunk <= 8; chunk++) {
+        CHECK(parse(PARSER_FORMAT_FORM, "threshold=21.5&ssid=my+net%26co&&empty=\r\n", chunk, &fields) == PARSER_OK);
+        CHECK(strcmp(fields.fields, "threshold=21.5\nssid=my net&co\nempty=\n") == 0);
+    }
+
+    CHECK(parse(PARSER_FORMAT_FORM, "a=%2", 64, &fields) == PARSER_ERROR_SYNTAX);
+    CHECK(parse(PARSER_FORMAT_FORM, "a=%zz", 64, &fields) == PARSER_ERROR_SYNTAX);
+}
+
+/**
+ * @brief Function for testing json bodies with strings, escapes and literals, split at every possible position.
+ */
+void test_parser_json() {
+    fields_t fields = {0};
+    const char *body = " { \"threshold\" : -1.5e1, \"ssid\":\"a\\\"b\\\\c\\u00e9\", \"adaptive\":true,\"t\":null } ";
+
+    for (size_t chunk = 1; chunk <= 8; chunk++) {
+        CHECK(parse(PARSER_FORMAT_JSON, body, chunk, &fields) == PARSER_OK);
+        CHECK(strcmp(fields.fields, "threshold=-1.5e1\nssid=a\"b\\c\xc3\xa9\nadaptive=true\nt=null\n") == 0);
+    }
+
+    CHECK(parse(PARSER_FORMAT_JSON, "{}", 64, &fields) == PARSER_OK);
+    CHECK(fields.len == 0);
+}
+
+/**
+ * @brief Function for testing that string written by writer_json_string is parsed to same value.
+ */
+void test_parser_json_round_trip() {
+    static collector_t collector;
+    static response_writer_t writer;
+    fields_t fields = {0};
+    const char *value = "net \"a\\b\"\r\n\x1f";
+
+    writer_open(&writer, collect_chunk, &collector);
+    writer_printf(&writer, "{\"ssid\":");
+    writer_json_string(&writer, value);
+    writer_printf(&writer, "}");
+    writer_finish(&writer);
+
+    CHECK(parse(PARSER_FORMAT_JSON, collector.data, 5, &fields) == PARSER_OK);
+    CHECK(strncmp(fields.fields, "ssid=", 5) == 0);
+    CHECK(strncmp(fields.fields + 5, value, strlen(value)) == 0);
+}
+
+/**
+ * @brief Function for testing errors of parser.
+ */
+void test_parser_errors() {
+    fields_t fields = {0};
+    char body[PARSER_VALUE_MAX + 16];
+
+    CHECK(parse(PARSER_FORMAT_JSON, "{\"a\":{\"b\":1}}", 64, &fields) == PARSER_ERROR_SYNTAX);
+    CHECK(parse(PARSER_FORMAT_JSON, "{\"a\":[1]}", 64, &fields) == PARSER_ERROR_SYNTAX);
+    CHECK(parse(PARSER_FORMAT_JSON, "{\"a\":1", 64, &fields) == PARSER_ERROR_SYNTAX);
+    CHECK(parse(PARSER_FORMAT_JSON, "{\"a\":1,}", 64, &fields) == PARSER_ERROR_SYNTAX);
+    CHECK(parse(PARSER_FORMAT_JSON, "{\"a\":\"\\x\"}", 64, &fields) == PARSER_ERROR_SYNTAX);
+    CHECK(parse(PARSER_FORMAT_JSON, "{\"a\":\"\\ud800\"}", 64, &fields) == PARSER_ERROR_SYNTAX);
+    CHECK(parse(PARSER_FORMAT_JSON, "{\"a\":1} x", 64, &fields) == PARSER_ERROR_SYNTAX);
+
+    snprintf(body, sizeof(body), "a=%0*d", PARSER_VALUE_MAX + 1, 0);
+    CHECK(parse(PARSER_FORMAT_FORM, body, 64, &fields) == PARSER_ERROR_TOO_LONG);
+
+    fields.reject = "bad";
+    CHECK(parse(PARSER_FORMAT_FORM, "good=1&bad=2&later=3", 64, &fields) == PARSER_ERROR_FIELD);
+    CHECK(strcmp(fields.fields, "good=1\n") == 0);
+}
+
+/************************ ALERT RULES ************************/
+
+#define SECOND_US 1000000LL // microseconds of one second
+
+/**
+ * @brief Function for testing above rule with minimum duration and hysteresis.
+ */
+void test_alert_above() {
+    alert_rule_t rule = {.type = ALERT_ABOVE, .channel = 0, .limit = 30.0, .hysteresis = 1.0, .duration_s = 10};
+    alert_state_t state = {0};
+
+    CHECK(!alert_evaluate(&rule, &state, 25.0, 0));
+    CHECK(!alert_evaluate(&rule, &state, 31.0, 1 * SECOND_US));
+    CHECK(!alert_evaluate(&rule, &state, 31.0, 10 * SECOND_US));
+    CHECK(alert_evaluate(&rule, &state, 31.0, 11 * SECOND_US));
+    CHECK(state.active);
+
+    // within hysteresis band alert stays raised, short dip below does not release it
+    CHECK(!alert_evaluate(&rule, &state, 29.5, 12 * SECOND_US));
+    CHECK(!alert_evaluate(&rule, &state, 28.0, 13 * SECOND_US));
+    CHECK(!alert_evaluate(&rule, &state, 31.0, 20 * SECOND_US));
+    CHECK(state.active && !state.pending);
+
+    CHECK(!alert_evaluate(&rule, &state, 28.0, 30 * SECOND_US));
+    CHECK(alert_evaluate(&rule, &state, 28.0, 40 * SECOND_US));
+    CHECK(!state.active);
+}
+
+/**
+ * @brief Function for testing below rule without duration.
+ */
+void test_alert_below() {
+    alert_rule_t rule = {.type = ALERT_BELOW, .channel = 0, .limit = 5.0, .hysteresis = 0.5, .duration_s = 0};
+    alert_state_t state = {0};
+
+    CHECK(!alert_evaluate(&rule, &state, 6.0, 0));
+    CHECK(alert_evaluate(&rule, &state, 4.0, SECOND_US));
+    CHECK(!alert_evaluate(&rule, &state, 5.2, 2 * SECOND_US));
+    CHECK(alert_evaluate(&rule, &state, 5.6, 3 * SECOND_US));
+    CHECK(!state.active);
+
+    // missing value carries no information
+    CHECK(!alert_evaluate(&rule, &state, NAN, 4 * SECOND_US));
+    CHECK(!state.active);
+}
+
+/**
+ * @brief Function for testing rate rule, rate is measured over at least ALERT_RATE_WINDOW_US.
+ */
+void test_alert_rate() {
+    alert_rule_t rule = {.type = ALERT_RATE, .channel = 0, .limit = 2.0, .hysteresis = 0.5, .duration_s = 0};
+    alert_state_t state = {0};
+
+    CHECK(!alert_evaluate(&rule, &state, 20.0, 0));
+    CHECK(!alert_evaluate(&rule, &state, 25.0, 30 * SECOND_US)); // window is not complete
+    CHECK(alert_evaluate(&rule, &state, 23.0, 60 * SECOND_US));
+    CHECK(fabs(state.rate - 3.0) < 1e-9);
+
+    CHECK(!alert_evaluate(&rule, &state, 21.2, 120 * SECOND_US)); // -1.8 per minute is within hysteresis
+    CHECK(alert_evaluate(&rule, &state, 20.2, 180 * SECOND_US));
+    CHECK(!state.active);
+}
+
+/**
+ * @brief Function for testing stale rule on channel without valid values.
+ */
+void test_alert_stale() {
+    alert_rule_t rule = {.type = ALERT_STALE, .channel = 0, .limit = 30.0, .hysteresis = 0.0, .duration_s = 0};
+    alert_state_t state = {0};
+
+    CHECK(!alert_evaluate(&rule, &state, 20.0, 0));
+    CHECK(!alert_evaluate(&rule, &state, NAN, 29 * SECOND_US));
+    CHECK(alert_evaluate(&rule, &state, NAN, 30 * SECOND_US));
+    CHECK(state.active);
+    CHECK(alert_evaluate(&rule, &state, 20.0, 31 * SECOND_US));
+    CHECK(!state.active);
+}
+
+/************************ MAIN ************************/
+
+int main() {
+    test_lut_table();
+    test_lut_convert();
+    test_lut_find_raw();
+    test_threshold_evaluate();
+    test_varint();
+    test_log_block_check();
+    test_log_block_round_trip();
+    test_log_decoder_truncated();
+    test_writer();
+    test_writer_json_string();
+    test_parser_form();
+    test_parser_json();
+    test_parser_json_round_trip();
+    test_parser_errors();
+    test_alert_above();
+    test_alert_below();
+    test_alert_rate();
+    test_alert_stale();
+
+    printf("%lu checks, %lu failures\n", (unsigned long)checks, (unsigned long)failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*** End of test_pipeline.c ***/
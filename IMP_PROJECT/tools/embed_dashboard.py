@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""
+@file embed_dashboard.py
+@brief Compresses web/index.html and writes it as C array to src/dashboard.h.
+       Run after every change of the page: python3 tools/embed_dashboard.py
+"""
+
+import gzip
+import hashlib
+import pathlib
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+SOURCE = ROOT / "web" / "index.html"
+TARGET = ROOT / "src" / "dashboard.h"
+
+
+def main():
+    html = SOURCE.read_bytes()
+    # mtime=0 so output only depends on page content
+    blob = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(html).hexdigest()[:16]
+
+    lines = []
+    for i in range(0, len(blob), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in blob[i:i + 16]) + ",")
+
+    TARGET.write_text(
+        "/*\n"
+        " * @file dashboard.h\n"
+        " * @brief Gzip compressed web page, generated from web/index.html by tools/embed_dashboard.py. Do not edit.\n"
+        " */\n"
+        "\n"
+        "#ifndef DASHBOARD_H\n"
+        "#define DASHBOARD_H\n"
+        "\n"
+        "#include <stdint.h>\n"
+        "\n"
+        "#define DASHBOARD_ETAG \"\\\"%s\\\"\" // etag of page, changes with content\n"
+        "#define DASHBOARD_SIZE %d // size of compressed page, uncompressed %d\n"
+        "\n"
+        "static const uint8_t dashboard_html_gz[DASHBOARD_SIZE] = {\n"
+        "%s\n"
+        "};\n"
+        "\n"
+        "#endif // DASHBOARD_H\n"
+        "\n"
+        "/*** End of dashboard.h ***/\n" % (etag, len(blob), len(html), "\n".join(lines)))
+
+
+if __name__ == "__main__":
+    main()